@@ -0,0 +1,178 @@
+#define _DEFAULT_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/resource.h>
+
+#include "CacheEngine.h"
+#include "Generator.h"
+#include "Kernels.h"
+#include "Trace.h"
+
+/**********************************************************************/
+/* Name:        peakMemory                                            */
+/*                                                                    */
+/* Description: This function will return the largest resident set    */
+/*              of the process so far                                 */
+/*                                                                    */
+/* Inputs:      NONE                                                  */
+/*                                                                    */
+/* Outputs:     The peak resident set in kilobytes                    */
+/**********************************************************************/
+long peakMemory(void){
+    struct rusage usage;
+    if(getrusage(RUSAGE_SELF, &usage) != 0)
+        return 0;
+    return usage.ru_maxrss;
+}
+
+/**********************************************************************/
+/* Name:        timeKernel                                            */
+/*                                                                    */
+/* Description: This function will time a kernel over a trace in a    */
+/*              new cache                                             */
+/*                                                                    */
+/* Inputs:      The configuration; the kernel, NULL to choose it from */
+/*              the cache; the trace; its length; the hits            */
+/*                                                                    */
+/* Outputs:     The seconds taken, a negative value on a bad          */
+/*              configuration                                         */
+/**********************************************************************/
+double timeKernel(const struct cacheConfig *config, cacheKernel kernel,
+                  const unsigned int addresses[], size_t count, unsigned long long *hits){
+
+    struct cacheEngine cache;
+
+    if(cacheInit(&cache, config) != 0)
+        return -1.0;
+    if(kernel == NULL)
+        kernel = kernelSelect(&cache);
+
+    double start = wallClock();
+    kernel(&cache, addresses, count);
+    double seconds = wallClock() - start;
+
+    *hits = cache.hits;
+    cacheFree(&cache);
+    return seconds;
+}
+
+/**********************************************************************/
+/* Name:        benchmark                                             */
+/*                                                                    */
+/* Description: This function will time the accesses of a trace        */
+/*              through the generic engine and through the kernel     */
+/*              chosen for the cache, and print one row of results    */
+/*                                                                    */
+/* Inputs:      The name of the pattern; the name of the cache; its   */
+/*              configuration; the trace; its length                  */
+/*                                                                    */
+/* Outputs:     0 on success, -1 on a bad configuration or when the   */
+/*              kernel disagrees with the engine                      */
+/**********************************************************************/
+int benchmark(const char *pattern, const char *name, const struct cacheConfig *config,
+              const unsigned int addresses[], size_t count){
+
+    unsigned long long hits, kernelHits;
+    double generic = timeKernel(config, kernelGeneric, addresses, count, &hits);
+    double specialized = timeKernel(config, NULL, addresses, count, &kernelHits);
+
+    if(generic < 0.0 || specialized < 0.0 || hits != kernelHits)
+        return -1;
+    printf("| %-10s | %-6s | %8.6f | %10.2f | %9.2f | %7.2f | %12.1f | %10ld |\n", pattern, name,
+           hits/(double)count, generic * 1e9 / count, specialized * 1e9 / count,
+           generic / specialized, count / specialized / 1e6, peakMemory());
+    return 0;
+}
+
+int main(int argc, char *argv[]){
+
+    struct generator   generator = { SEQUENTIAL, 1u << 24, 256, 0.99, 1 };
+    struct cacheConfig direct = { 4096, 1, 64, FIFO, WRITEBACK, WRITEALLOCATE };
+    struct cacheConfig set = { 512, 8, 64, LRU, WRITEBACK, WRITEALLOCATE };
+    struct cacheConfig associative = { 1, 4096, 64, LRU, WRITEBACK, WRITEALLOCATE };
+    size_t             count = 1u << 24;
+    int                only = -1;
+    int                option;
+    char               *end = "";
+
+    while((option = getopt(argc, argv, "n:f:t:z:g:s:w:p:")) != -1){
+        switch(option){
+          case 'n':
+              count = parseSize(optarg, &end);
+              break;
+          case 'f':
+              generator.footprint = (unsigned int)parseSize(optarg, &end);
+              break;
+          case 't':
+              generator.stride = (unsigned int)parseSize(optarg, &end);
+              break;
+          case 'z':
+              generator.skew = strtod(optarg, NULL);
+              break;
+          case 'g':
+              only = namedValue(optarg, patternNames, POINTERCHASE + 1);
+              if(only < 0)
+                  count = 0;
+              break;
+          case 's':
+              direct.sets = (unsigned int)parseSize(optarg, &end);
+              break;
+          case 'w':
+              associative.ways = (unsigned int)parseSize(optarg, &end);
+              break;
+          case 'p':
+              associative.policy = policyName(optarg);
+              break;
+          default :
+              count = 0;
+        }
+        if(*end != '\0')
+            count = 0;
+    }
+    if(count == 0){
+        fprintf(stderr, "usage: %s [-n accesses] [-f footprint] [-t stride] [-z zipf skew] "
+                "[-g sequential|strided|uniform|zipf|chase] [-s direct mapped sets] "
+                "[-w fully associative ways] [-p policy]\n", argv[0]);
+        fprintf(stderr, "  sizes take K, M and G suffixes; the caches have 64 byte lines and the "
+                "8-way one 512 sets of lru; every cache runs through the generic engine and "
+                "through its specialized kernel, if it has one\n");
+        return 1;
+    }
+
+    unsigned int *addresses = malloc(count * sizeof(unsigned int));
+    if(addresses == NULL){
+        fprintf(stderr, "%s: out of memory\n", argv[0]);
+        return 1;
+    }
+
+    printf("%zu accesses over a %u byte footprint\n", count, generator.footprint);
+    printf("----------------------------------------------------------------------------------------------------\n");
+    printf("|  PATTERN   | CACHE  | HIT RATE | GENERIC NS | KERNEL NS | SPEEDUP | M ACCESSES/S | PEAK RSS K |\n");
+    printf("----------------------------------------------------------------------------------------------------\n");
+    for(int pattern = SEQUENTIAL; pattern <= POINTERCHASE; pattern++){
+        if(only >= 0 && pattern != only)
+            continue;
+        generator.pattern = pattern;
+        if(generateTrace(&generator, addresses, count) != 0){
+            fprintf(stderr, "%s: the footprint must be a power of two of at least %d bytes\n",
+                    argv[0], GENERATORLINE);
+            free(addresses);
+            return 1;
+        }
+        if(benchmark(patternNames[pattern], "direct", &direct, addresses, count) != 0 ||
+           benchmark(patternNames[pattern], "8-way", &set, addresses, count) != 0 ||
+           benchmark(patternNames[pattern], "fully", &associative, addresses, count) != 0){
+            fprintf(stderr, "%s: invalid cache configuration, or the kernel disagrees with "
+                    "the engine\n", argv[0]);
+            free(addresses);
+            return 1;
+        }
+    }
+    printf("----------------------------------------------------------------------------------------------------\n");
+
+    free(addresses);
+    return 0;
+}
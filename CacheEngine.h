@@ -0,0 +1,1048 @@
+#ifndef CACHE_ENGINE_H
+#define CACHE_ENGINE_H
+
+#include <errno.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* The AVX2 and AVX-512 tag compares are compiled for every x86 build and
+selected at runtime, like the parser of Trace.h */
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define ENGINE_SIMD 1
+#include <immintrin.h>
+#endif
+
+/* The programs include the engine once and use its functions directly.
+The library defines ENGINE_PRIVATE to give them internal linkage, so the
+object it builds only exports the interface of CacheLibrary.h */
+#ifdef ENGINE_PRIVATE
+#define ENGINEFUNCTION static inline
+#define ENGINEDATA     static
+#else
+#define ENGINEFUNCTION
+#define ENGINEDATA
+#endif
+
+/* An entry of a cache; its state and the timer of its last use are kept
+in arrays of their own, see struct cacheEngine */
+struct cache{
+    unsigned long long address;
+    char         coherence;     /* MESI/MOESI state, see Coherence.h */
+    char         dirty;         /* 1 if the line differs from the next level */
+    char         prefetched;    /* 1 if a prefetch filled it and it is unused */
+};
+
+enum values { VALID = 0, INVALID, EMPTY };
+
+/* The line a fill replaced, if it was valid */
+struct eviction{
+    int          valid;         /* 0 if the fill took an invalid entry */
+    struct cache line;
+};
+
+/* Replacement policies; FIFO is the round robin order of the original
+simulators */
+enum policy { FIFO = 0, LRU, PLRU, RRIP, RANDOM };
+
+ENGINEDATA const char *policyNames[] = { "fifo", "lru", "plru", "rrip", "random" };
+
+/* What a write does: a write back cache marks the line dirty and writes it
+to the next level when it is evicted, a write through cache sends every
+write to the next level. A write miss fills the line only under write
+allocate; otherwise the write goes straight to the next level */
+enum writePolicy { WRITEBACK = 0, WRITETHROUGH };
+enum allocatePolicy { WRITEALLOCATE = 0, NOWRITEALLOCATE };
+
+ENGINEDATA const char *writePolicyNames[] = { "writeback", "writethrough" };
+ENGINEDATA const char *allocatePolicyNames[] = { "allocate", "noallocate" };
+
+/* Types of access; Trace.h declares them too */
+#ifndef ACCESS_TYPES
+#define ACCESS_TYPES
+enum access { READ = 0, WRITE };
+#endif
+
+/* Bytes of an access whose size is not given; such an access stops at the
+end of its line, so it always counts once */
+#define ACCESSSIZE 4
+
+/* Fully associative caches with at least this many ways find their
+entries through a hash index instead of scanning them */
+#define HASHTHRESHOLD 64
+
+/* Re-reference prediction values of RRIP */
+#define RRPVMAX    3
+#define RRPVINSERT 2
+
+/* No entry; marks the ends of the recency list and the empty buckets of
+the hash index */
+#define NOENTRY 0xffffffffu
+
+/* Widest tag compare the processor supports */
+enum tagCompare { SCALARTAGS = 0, AVX2TAGS, AVX512TAGS };
+
+struct cacheConfig{
+    unsigned int sets;          /* Number of sets, a power of two */
+    unsigned int ways;          /* Number of entries in every set */
+    unsigned int lineSize;      /* Bytes per line, a power of two */
+    int          policy;        /* Replacement policy */
+    int          writePolicy;   /* WRITEBACK or WRITETHROUGH */
+    int          allocate;      /* WRITEALLOCATE or NOWRITEALLOCATE */
+};
+
+/* Geometry and state of one simulated cache. The entries are stored set
+by set, so the ways of a set are contiguous; a direct mapped cache is the
+1-way case and a fully associative cache is the 1-set case. The line
+addresses, the states and the timers of the entries are kept apart in
+arrays of their own, in the same order, so a lookup compares a whole set
+of tags with a few vector instructions and only reads the state of a way
+that matches. Any line address is a valid tag, so an invalid entry is
+told apart by its state alone */
+struct cacheEngine{
+    unsigned int  sets;         /* Number of sets, a power of two */
+    unsigned int  ways;         /* Number of entries in every set */
+    unsigned int  lineSize;     /* Bytes per line, a power of two */
+    unsigned int  offsetBits;   /* log2(lineSize) */
+    unsigned int  setMask;      /* sets - 1 */
+    int           policy;       /* Replacement policy */
+    struct cache  *entries;     /* sets * ways entries */
+    unsigned long long *tags;   /* Line address of every entry */
+    unsigned char *states;      /* VALID or INVALID for every entry */
+    unsigned long long *timers; /* Timer of the cache at the last use of every entry */
+    int           simd;         /* Tag compare used by cacheFind */
+    unsigned int  *victim;      /* Next entry to replace in every set */
+    unsigned int  *filled;      /* Valid entries in every set */
+    unsigned int  *spare;       /* Invalid entries of a hashed cache */
+    unsigned int  spareCount;
+    unsigned char *metadata;    /* RRPV of every entry or PLRU tree of every set */
+    unsigned int  seed;         /* State of the random policy */
+
+    /* Hash index of a large fully associative cache, and its recency list
+    under FIFO and LRU. Under RRIP every RRPV has a list instead, and the
+    entries keep in the metadata the RRPV they had when the set was last
+    aged, see policyVictim */
+    unsigned int  *bucket;      /* Entry of every bucket, or NOENTRY */
+    unsigned int  hashMask;     /* Buckets - 1 */
+    unsigned int  hashShift;    /* 32 - log2(buckets) */
+    unsigned int  *newer;       /* Next entry towards the most recent */
+    unsigned int  *older;       /* Next entry towards the least recent */
+    unsigned int  newest[RRPVMAX + 1];  /* Ends of every list */
+    unsigned int  oldest[RRPVMAX + 1];
+    unsigned int  rrpvAge;      /* Times the set has been aged, modulo RRPVMAX + 1 */
+
+    int           writePolicy;
+    int           allocate;
+
+    /* 64 bits, so that traces of billions of accesses neither wrap the
+    counters nor reorder the timers of LRU */
+    unsigned long long hits;
+    unsigned long long events;
+    unsigned long long timer;
+
+    /* Traffic with the next level */
+    unsigned long long writes;
+    unsigned long long writeHits;
+    unsigned long long writebacks;      /* Dirty lines evicted */
+    unsigned long long fillBytes;       /* Lines read from the next level */
+    unsigned long long writebackBytes;  /* Dirty lines written back */
+    unsigned long long writeThroughBytes; /* Writes sent to the next level */
+
+    /* Lines filled by a prefetcher, see Prefetch.h. A prefetch is late
+    when its line is used fewer than prefetchLatency demand accesses after
+    it was issued; the timer would also count the fills of the other
+    prefetches */
+    unsigned int       prefetchLatency;
+    unsigned long long demand;          /* Lookups, the clock of prefetches */
+    unsigned long long *issued;         /* Demand clock at the prefetch of every entry */
+    unsigned long long prefetches;      /* Lines filled by a prefetch */
+    unsigned long long prefetchHits;    /* Prefetched lines used */
+    unsigned long long prefetchLate;    /* Prefetched lines used too early */
+    unsigned long long prefetchUnused;  /* Prefetched lines evicted unused */
+};
+
+/**********************************************************************/
+/* Name:        isPowerOfTwo                                          */
+/*                                                                    */
+/* Description: This function will check that a number is a non zero  */
+/*              power of two                                          */
+/*                                                                    */
+/* Inputs:      A number                                              */
+/*                                                                    */
+/* Outputs:     1 if the number is a power of two, 0 otherwise        */
+/**********************************************************************/
+ENGINEFUNCTION
+int isPowerOfTwo(unsigned int number){
+    return number != 0 && (number & (number - 1)) == 0;
+}
+
+/**********************************************************************/
+/* Name:        namedValue                                            */
+/*                                                                    */
+/* Description: This function will find a name in a table of names    */
+/*                                                                    */
+/* Inputs:      The name; the table; the number of names              */
+/*                                                                    */
+/* Outputs:     The index of the name, -1 if it is not in the table   */
+/**********************************************************************/
+ENGINEFUNCTION
+int namedValue(const char *name, const char *names[], int count){
+    for(int i = 0; i < count; i++)
+        if(strcmp(name, names[i]) == 0)
+            return i;
+    return -1;
+}
+
+/**********************************************************************/
+/* Name:        policyName                                            */
+/*                                                                    */
+/* Description: This function will find the replacement policy with   */
+/*              a given name                                          */
+/*                                                                    */
+/* Inputs:      The name of the policy                                */
+/*                                                                    */
+/* Outputs:     The policy, -1 if there is no policy with that name   */
+/**********************************************************************/
+ENGINEFUNCTION
+int policyName(const char *name){
+    return namedValue(name, policyNames, RANDOM + 1);
+}
+
+/**********************************************************************/
+/* Name:        parseSize                                             */
+/*                                                                    */
+/* Description: This function will read a number with an optional K,  */
+/*              M or G suffix                                         */
+/*                                                                    */
+/* Inputs:      The text; a pointer that will point after the number, */
+/*              or at the text if it does not fit in 64 bits          */
+/*                                                                    */
+/* Outputs:     The number                                            */
+/**********************************************************************/
+ENGINEFUNCTION
+unsigned long long parseSize(const char *text, char **end){
+
+    unsigned long long value;
+    unsigned int shift = 0;
+
+    errno = 0;
+    value = strtoull(text, end, 0);
+    switch(**end){
+      case 'K': case 'k':
+          shift = 10;
+          break;
+      case 'M': case 'm':
+          shift = 20;
+          break;
+      case 'G': case 'g':
+          shift = 30;
+          break;
+    }
+    if(shift != 0)
+        (*end)++;
+    if(errno == ERANGE || value > ULLONG_MAX >> shift || text[strspn(text, " \t")] == '-'){
+        *end = (char *)text;
+        return 0;
+    }
+    return value << shift;
+}
+
+/**********************************************************************/
+/* Name:        hashLine                                              */
+/*                                                                    */
+/* Description: This function will find the bucket of a line address  */
+/*              in the hash index, using Fibonacci hashing            */
+/*                                                                    */
+/* Inputs:      The cache; the line address                           */
+/*                                                                    */
+/* Outputs:     The first bucket to probe                             */
+/**********************************************************************/
+ENGINEFUNCTION
+unsigned int hashLine(struct cacheEngine *cache, unsigned long long lineAddress){
+    unsigned long long line = lineAddress >> cache->offsetBits;
+    return (unsigned int)((line * 0x9e3779b97f4a7c15ull) >> (32 + cache->hashShift));
+}
+
+/**********************************************************************/
+/* Name:        hashFind                                              */
+/*                                                                    */
+/* Description: This function will look a line address up in the      */
+/*              hash index                                            */
+/*                                                                    */
+/* Inputs:      The cache; the line address                           */
+/*                                                                    */
+/* Outputs:     The entry holding the line, NOENTRY if it is absent   */
+/**********************************************************************/
+ENGINEFUNCTION
+unsigned int hashFind(struct cacheEngine *cache, unsigned long long lineAddress){
+
+    unsigned int i = hashLine(cache, lineAddress);
+    while(cache->bucket[i] != NOENTRY){
+        if(cache->tags[cache->bucket[i]] == lineAddress)
+            return cache->bucket[i];
+        i = (i + 1) & cache->hashMask;
+    }
+    return NOENTRY;
+}
+
+/**********************************************************************/
+/* Name:        hashInsert                                            */
+/*                                                                    */
+/* Description: This function will add an entry to the hash index      */
+/*                                                                    */
+/* Inputs:      The cache; the entry, which already holds its line    */
+/*                                                                    */
+/* Outputs:     NONE                                                  */
+/**********************************************************************/
+ENGINEFUNCTION
+void hashInsert(struct cacheEngine *cache, unsigned int entry){
+
+    unsigned int i = hashLine(cache, cache->entries[entry].address);
+    while(cache->bucket[i] != NOENTRY)
+        i = (i + 1) & cache->hashMask;
+    cache->bucket[i] = entry;
+}
+
+/**********************************************************************/
+/* Name:        hashRemove                                            */
+/*                                                                    */
+/* Description: This function will remove an entry from the hash       */
+/*              index. The entries after it in the probe sequence are */
+/*              shifted back, so no tombstones are needed             */
+/*                                                                    */
+/* Inputs:      The cache; the entry, which still holds its line      */
+/*                                                                    */
+/* Outputs:     NONE                                                  */
+/**********************************************************************/
+ENGINEFUNCTION
+void hashRemove(struct cacheEngine *cache, unsigned int entry){
+
+    unsigned int i = hashLine(cache, cache->entries[entry].address);
+    while(cache->bucket[i] != entry)
+        i = (i + 1) & cache->hashMask;
+
+    unsigned int hole = i;
+    for(;;){
+        i = (i + 1) & cache->hashMask;
+        if(cache->bucket[i] == NOENTRY)
+            break;
+
+        /* Move the entry to the hole unless its home bucket lies
+        cyclically between the hole and its current bucket */
+        unsigned int home = hashLine(cache, cache->entries[cache->bucket[i]].address);
+        if(((i - home) & cache->hashMask) >= ((i - hole) & cache->hashMask)){
+            cache->bucket[hole] = cache->bucket[i];
+            hole = i;
+        }
+    }
+    cache->bucket[hole] = NOENTRY;
+}
+
+/**********************************************************************/
+/* Name:        listUnlink                                            */
+/*                                                                    */
+/* Description: This function will take an entry out of its list      */
+/*                                                                    */
+/* Inputs:      The cache; the list; the entry                        */
+/*                                                                    */
+/* Outputs:     NONE                                                  */
+/**********************************************************************/
+ENGINEFUNCTION
+void listUnlink(struct cacheEngine *cache, unsigned int list, unsigned int entry){
+
+    unsigned int newer = cache->newer[entry];
+    unsigned int older = cache->older[entry];
+
+    if(newer != NOENTRY)
+        cache->older[newer] = older;
+    else
+        cache->newest[list] = older;
+    if(older != NOENTRY)
+        cache->newer[older] = newer;
+    else
+        cache->oldest[list] = newer;
+}
+
+/**********************************************************************/
+/* Name:        listPushNewest                                        */
+/*                                                                    */
+/* Description: This function will make an entry the most recent one   */
+/*              of a list                                             */
+/*                                                                    */
+/* Inputs:      The cache; the list; an entry that is in no list      */
+/*                                                                    */
+/* Outputs:     NONE                                                  */
+/**********************************************************************/
+ENGINEFUNCTION
+void listPushNewest(struct cacheEngine *cache, unsigned int list, unsigned int entry){
+
+    cache->newer[entry] = NOENTRY;
+    cache->older[entry] = cache->newest[list];
+    if(cache->newest[list] != NOENTRY)
+        cache->newer[cache->newest[list]] = entry;
+    else
+        cache->oldest[list] = entry;
+    cache->newest[list] = entry;
+}
+
+/**********************************************************************/
+/* Name:        listOf                                                */
+/*                                                                    */
+/* Description: This function will return the list of an entry of a   */
+/*              hashed cache                                          */
+/*                                                                    */
+/* Inputs:      The cache; the entry                                  */
+/*                                                                    */
+/* Outputs:     The list                                              */
+/**********************************************************************/
+ENGINEFUNCTION
+unsigned int listOf(const struct cacheEngine *cache, unsigned int entry){
+    return cache->policy == RRIP ? cache->metadata[entry] : 0;
+}
+
+/**********************************************************************/
+/* Name:        cacheInit                                             */
+/*                                                                    */
+/* Description: This function will allocate a cache with the given     */
+/*              configuration and mark all its entries as INVALID.    */
+/*              The number of sets and the line size must be powers   */
+/*              of two so the set can be taken with a shift and a     */
+/*              mask; tree PLRU also needs a power of two of ways     */
+/*                                                                    */
+/* Inputs:      The cache; the configuration                          */
+/*                                                                    */
+/* Outputs:     0 on success, -1 on a bad configuration or no memory  */
+/**********************************************************************/
+ENGINEFUNCTION
+int cacheInit(struct cacheEngine *cache, const struct cacheConfig *config){
+
+    unsigned int sets = config->sets;
+    unsigned int ways = config->ways;
+    size_t       size = (size_t)sets * ways;
+
+    memset(cache, 0, sizeof(*cache));
+    if(!isPowerOfTwo(sets) || !isPowerOfTwo(config->lineSize) || ways == 0)
+        return -1;
+    if(config->policy < FIFO || config->policy > RANDOM)
+        return -1;
+    if(config->policy == PLRU && !isPowerOfTwo(ways))
+        return -1;
+    if(config->writePolicy < WRITEBACK || config->writePolicy > WRITETHROUGH ||
+       config->allocate < WRITEALLOCATE || config->allocate > NOWRITEALLOCATE)
+        return -1;
+
+    cache->sets = sets;
+    cache->ways = ways;
+    cache->lineSize = config->lineSize;
+    cache->policy = config->policy;
+    cache->writePolicy = config->writePolicy;
+    cache->allocate = config->allocate;
+    cache->setMask = sets - 1;
+    while((1u << cache->offsetBits) < config->lineSize)
+        cache->offsetBits++;
+    cache->seed = 2463534242u;
+
+#ifdef ENGINE_SIMD
+    if(__builtin_cpu_supports("avx512f"))
+        cache->simd = AVX512TAGS;
+    else if(__builtin_cpu_supports("avx2"))
+        cache->simd = AVX2TAGS;
+#endif
+
+    cache->entries = malloc(size * sizeof(struct cache));
+    cache->tags = calloc(size, sizeof(unsigned long long));
+    cache->states = malloc(size);
+    cache->timers = calloc(size, sizeof(unsigned long long));
+    cache->victim = calloc(sets, sizeof(unsigned int));
+    cache->filled = calloc(sets, sizeof(unsigned int));
+    cache->metadata = calloc(size, 1);
+    if(cache->entries == NULL || cache->tags == NULL || cache->states == NULL ||
+       cache->timers == NULL || cache->victim == NULL || cache->filled == NULL ||
+       cache->metadata == NULL)
+        goto failed;
+
+    /* A large fully associative cache gets a hash index with at least
+    twice as many buckets as entries, and a recency list */
+    if(sets == 1 && ways >= HASHTHRESHOLD){
+        unsigned int buckets = 1;
+        cache->hashShift = 32;
+        while(buckets < 2 * ways){
+            buckets <<= 1;
+            cache->hashShift--;
+        }
+        cache->hashMask = buckets - 1;
+        cache->bucket = malloc((size_t)buckets * sizeof(unsigned int));
+        if(cache->bucket == NULL)
+            goto failed;
+        memset(cache->bucket, 0xff, (size_t)buckets * sizeof(unsigned int));
+
+        /* The invalid entries are a stack, with the first one on top */
+        cache->spare = malloc(size * sizeof(unsigned int));
+        if(cache->spare == NULL)
+            goto failed;
+        for(unsigned int j = 0; j < ways; j++)
+            cache->spare[j] = ways - 1 - j;
+        cache->spareCount = ways;
+
+        /* FIFO, LRU and RRIP find their victim at the old end of a list */
+        if(config->policy == FIFO || config->policy == LRU || config->policy == RRIP){
+            cache->newer = malloc(size * sizeof(unsigned int));
+            cache->older = malloc(size * sizeof(unsigned int));
+            if(cache->newer == NULL || cache->older == NULL)
+                goto failed;
+            for(int list = 0; list <= RRPVMAX; list++){
+                cache->newest[list] = NOENTRY;
+                cache->oldest[list] = NOENTRY;
+            }
+        }
+    }
+
+    /* Initialize the cache */
+    memset(cache->states, INVALID, size);
+    for(size_t i = 0; i < size; i++){
+        cache->entries[i].coherence = 0;
+        cache->entries[i].dirty = 0;
+        cache->entries[i].prefetched = 0;
+        cache->entries[i].address = EMPTY;
+    }
+    return 0;
+
+failed:
+    free(cache->entries);
+    free(cache->tags);
+    free(cache->states);
+    free(cache->timers);
+    free(cache->victim);
+    free(cache->filled);
+    free(cache->spare);
+    free(cache->metadata);
+    free(cache->bucket);
+    free(cache->newer);
+    free(cache->older);
+    memset(cache, 0, sizeof(*cache));
+    return -1;
+}
+
+/**********************************************************************/
+/* Name:        cacheFree                                             */
+/*                                                                    */
+/* Description: This function will release the memory of a cache      */
+/*                                                                    */
+/* Inputs:      The cache                                             */
+/*                                                                    */
+/* Outputs:     NONE                                                  */
+/**********************************************************************/
+ENGINEFUNCTION
+void cacheFree(struct cacheEngine *cache){
+    free(cache->entries);
+    free(cache->tags);
+    free(cache->states);
+    free(cache->timers);
+    free(cache->victim);
+    free(cache->filled);
+    free(cache->spare);
+    free(cache->metadata);
+    free(cache->bucket);
+    free(cache->newer);
+    free(cache->older);
+    free(cache->issued);
+    memset(cache, 0, sizeof(*cache));
+}
+
+/**********************************************************************/
+/* Name:        cacheClearCounters                                    */
+/*                                                                    */
+/* Description: This function will reset the counters of a cache and  */
+/*              keep its contents, so a warmed cache can be measured  */
+/*                                                                    */
+/* Inputs:      The cache                                             */
+/*                                                                    */
+/* Outputs:     NONE                                                  */
+/**********************************************************************/
+ENGINEFUNCTION
+void cacheClearCounters(struct cacheEngine *cache){
+    cache->hits = 0;
+    cache->events = 0;
+    cache->writes = 0;
+    cache->writeHits = 0;
+    cache->writebacks = 0;
+    cache->fillBytes = 0;
+    cache->writebackBytes = 0;
+    cache->writeThroughBytes = 0;
+    cache->prefetches = 0;
+    cache->prefetchHits = 0;
+    cache->prefetchLate = 0;
+    cache->prefetchUnused = 0;
+}
+
+/**********************************************************************/
+/* Name:        policyTouch                                           */
+/*                                                                    */
+/* Description: This function will update the replacement metadata    */
+/*              of an entry that has just been hit or filled          */
+/*                                                                    */
+/* Inputs:      The cache; the set; the way; 1 for a fill, 0 for a    */
+/*              hit                                                   */
+/*                                                                    */
+/* Outputs:     NONE                                                  */
+/**********************************************************************/
+ENGINEFUNCTION
+void policyTouch(struct cacheEngine *cache, unsigned int set, unsigned int way, int fill){
+
+    size_t first = (size_t)set * cache->ways;
+
+    switch(cache->policy){
+      case FIFO:
+      case LRU:
+          /* The recency list keeps fill order for FIFO and use order for
+          LRU; small sets use the round robin pointer or the timers */
+          if(cache->newer != NULL && (fill || cache->policy == LRU)){
+              if(!fill)
+                  listUnlink(cache, 0, way);
+              listPushNewest(cache, 0, way);
+          }
+          break;
+      case PLRU:{
+          /* Point every node on the path to the entry away from it */
+          unsigned char *tree = &cache->metadata[first];
+          unsigned int node = cache->ways + way;
+          while(node > 1){
+              tree[node >> 1] = (node & 1) ? 0 : 1;
+              node >>= 1;
+          }
+          break;
+      }
+      case RRIP:
+          if(cache->newer != NULL){
+              /* The entry moves to the list of its new RRPV, stored
+              relative to the aging of the set */
+              unsigned int list = ((fill ? RRPVINSERT : 0) - cache->rrpvAge) & RRPVMAX;
+              if(!fill)
+                  listUnlink(cache, cache->metadata[way], way);
+              cache->metadata[way] = (unsigned char)list;
+              listPushNewest(cache, list, way);
+              break;
+          }
+          cache->metadata[first + way] = fill ? RRPVINSERT : 0;
+          break;
+      default :
+          break;
+    }
+}
+
+/**********************************************************************/
+/* Name:        policyVictim                                          */
+/*                                                                    */
+/* Description: This function will choose the entry of a full set     */
+/*              that will be replaced                                 */
+/*                                                                    */
+/* Inputs:      The cache; the set                                    */
+/*                                                                    */
+/* Outputs:     The way to replace                                    */
+/**********************************************************************/
+ENGINEFUNCTION
+unsigned int policyVictim(struct cacheEngine *cache, unsigned int set){
+
+    size_t first = (size_t)set * cache->ways;
+    unsigned int way = 0;
+
+    switch(cache->policy){
+      case FIFO:
+          if(cache->newer != NULL)
+              return cache->oldest[0];
+          way = cache->victim[set];
+          cache->victim[set] = (way + 1 == cache->ways) ? 0 : way + 1;
+          break;
+      case LRU:
+          if(cache->newer != NULL)
+              return cache->oldest[0];
+          for(unsigned int j = 1; j < cache->ways; j++)
+              if(cache->timers[first + j] < cache->timers[first + way])
+                  way = j;
+          break;
+      case PLRU:{
+          unsigned char *tree = &cache->metadata[first];
+          unsigned int node = 1;
+          while(node < cache->ways)
+              node = 2 * node + tree[node];
+          way = node - cache->ways;
+          break;
+      }
+      case RRIP:{
+          /* Age the set until an entry is predicted to be re-referenced
+          in the distant future. A hashed cache ages all its entries at
+          once by moving the RRPV every list stands for, and replaces the
+          entry that has had the distant RRPV the longest */
+          unsigned char *rrpv = &cache->metadata[first];
+          if(cache->newer != NULL){
+              unsigned int value = RRPVMAX;
+              while(cache->oldest[(value - cache->rrpvAge) & RRPVMAX] == NOENTRY)
+                  value--;
+              cache->rrpvAge = (cache->rrpvAge + RRPVMAX - value) & RRPVMAX;
+              return cache->oldest[(RRPVMAX - cache->rrpvAge) & RRPVMAX];
+          }
+          for(;;){
+              for(unsigned int j = 0; j < cache->ways; j++)
+                  if(rrpv[j] == RRPVMAX)
+                      return j;
+              for(unsigned int j = 0; j < cache->ways; j++)
+                  rrpv[j]++;
+          }
+      }
+      case RANDOM:
+          /* xorshift32 */
+          cache->seed ^= cache->seed << 13;
+          cache->seed ^= cache->seed >> 17;
+          cache->seed ^= cache->seed << 5;
+          way = cache->seed % cache->ways;
+          break;
+    }
+    return way;
+}
+
+#ifdef ENGINE_SIMD
+/**********************************************************************/
+/* Name:        tagMatchAvx2                                          */
+/*                                                                    */
+/* Description: This function will compare a line address with the    */
+/*              tags of a set four at a time, and check the state of  */
+/*              every way that matches                                */
+/*                                                                    */
+/* Inputs:      The tags and the states of the set; the ways; the     */
+/*              line address                                          */
+/*                                                                    */
+/* Outputs:     The way holding the line, NOENTRY if it is absent     */
+/**********************************************************************/
+__attribute__((target("avx2")))
+ENGINEFUNCTION
+unsigned int tagMatchAvx2(const unsigned long long *tags, const unsigned char *states,
+                          unsigned int ways, unsigned long long lineAddress){
+
+    __m256i key = _mm256_set1_epi64x((long long)lineAddress);
+    unsigned int j = 0;
+
+    for(; j + 4 <= ways; j += 4){
+        __m256i equal = _mm256_cmpeq_epi64(_mm256_loadu_si256((const __m256i *)(tags + j)), key);
+        unsigned int mask = (unsigned int)_mm256_movemask_pd(_mm256_castsi256_pd(equal));
+        for(; mask != 0; mask &= mask - 1)
+            if(states[j + __builtin_ctz(mask)] == VALID)
+                return j + (unsigned int)__builtin_ctz(mask);
+    }
+    for(; j < ways; j++)
+        if(tags[j] == lineAddress && states[j] == VALID)
+            return j;
+    return NOENTRY;
+}
+
+/**********************************************************************/
+/* Name:        tagMatchAvx512                                        */
+/*                                                                    */
+/* Description: This function will compare a line address with the    */
+/*              tags of a set eight at a time, and check the state of */
+/*              every way that matches; the last compare masks out    */
+/*              the ways past the end of the set                      */
+/*                                                                    */
+/* Inputs:      The tags and the states of the set; the ways; the     */
+/*              line address                                          */
+/*                                                                    */
+/* Outputs:     The way holding the line, NOENTRY if it is absent     */
+/**********************************************************************/
+__attribute__((target("avx512f")))
+ENGINEFUNCTION
+unsigned int tagMatchAvx512(const unsigned long long *tags, const unsigned char *states,
+                            unsigned int ways, unsigned long long lineAddress){
+
+    __m512i key = _mm512_set1_epi64((long long)lineAddress);
+
+    for(unsigned int j = 0; j < ways; j += 8){
+        __mmask8 valid = ways - j >= 8 ? 0xff : (__mmask8)((1u << (ways - j)) - 1);
+        unsigned int mask = _mm512_mask_cmpeq_epi64_mask(valid,
+                                                         _mm512_maskz_loadu_epi64(valid, tags + j),
+                                                         key);
+        for(; mask != 0; mask &= mask - 1)
+            if(states[j + __builtin_ctz(mask)] == VALID)
+                return j + (unsigned int)__builtin_ctz(mask);
+    }
+    return NOENTRY;
+}
+#endif
+
+/**********************************************************************/
+/* Name:        cacheFind                                             */
+/*                                                                    */
+/* Description: This function will look for the entry holding a line  */
+/*              in its set. The set is selected with a shift and a    */
+/*              mask, and its tags are compared with vector           */
+/*              instructions when there are enough ways; large fully  */
+/*              associative caches find the entry through the hash    */
+/*              index instead                                         */
+/*                                                                    */
+/* Inputs:      The cache; the set; the line address                  */
+/*                                                                    */
+/* Outputs:     The way holding the line, NOENTRY if it is absent     */
+/**********************************************************************/
+ENGINEFUNCTION
+unsigned int cacheFind(struct cacheEngine *cache, unsigned int set, unsigned long long lineAddress){
+
+    const unsigned long long *tags = &cache->tags[(size_t)set * cache->ways];
+    const unsigned char *states = &cache->states[(size_t)set * cache->ways];
+
+    /* The hash index only holds valid entries */
+    if(cache->bucket != NULL)
+        return hashFind(cache, lineAddress);
+#ifdef ENGINE_SIMD
+    if(cache->simd == AVX512TAGS && cache->ways >= 8)
+        return tagMatchAvx512(tags, states, cache->ways, lineAddress);
+    if(cache->simd != SCALARTAGS && cache->ways >= 4)
+        return tagMatchAvx2(tags, states, cache->ways, lineAddress);
+#endif
+    for(unsigned int j = 0; j < cache->ways; j++)
+        if(tags[j] == lineAddress && states[j] == VALID)
+            return j;
+    return NOENTRY;
+}
+
+/**********************************************************************/
+/* Name:        cacheLookup                                           */
+/*                                                                    */
+/* Description: This function will look an address up and, if it is   */
+/*              in the cache, update the timer and the replacement    */
+/*              metadata of its entry. It does not count the access,  */
+/*              except as the first use of a prefetched line          */
+/*                                                                    */
+/* Inputs:      The cache; an address in decimal format               */
+/*                                                                    */
+/* Outputs:     The entry holding the line, NULL on a miss            */
+/**********************************************************************/
+ENGINEFUNCTION
+struct cache *cacheLookup(struct cacheEngine *cache, unsigned long long address){
+
+    /* Drop the offset inside the line; the low bits of the line number
+    select the set */
+    unsigned long long line = address >> cache->offsetBits;
+    unsigned int set = (unsigned int)line & cache->setMask;
+    unsigned int j = cacheFind(cache, set, line << cache->offsetBits);
+    size_t i;
+    struct cache *entry;
+
+    cache->demand++;
+    if(j == NOENTRY)
+        return NULL;
+    i = (size_t)set * cache->ways + j;
+    entry = &cache->entries[i];
+    if(entry->prefetched){
+        entry->prefetched = 0;
+        cache->prefetchHits++;
+        if(cache->demand - cache->issued[i] < cache->prefetchLatency)
+            cache->prefetchLate++;
+    }
+    cache->timers[i] = cache->timer++;
+    policyTouch(cache, set, j, 0);
+    return entry;
+}
+
+/**********************************************************************/
+/* Name:        cacheProbe                                            */
+/*                                                                    */
+/* Description: This function will look an address up like           */
+/*              cacheLookup                                           */
+/*                                                                    */
+/* Inputs:      The cache; an address in decimal format               */
+/*                                                                    */
+/* Outputs:     1 on a hit, 0 on a miss                               */
+/**********************************************************************/
+ENGINEFUNCTION
+int cacheProbe(struct cacheEngine *cache, unsigned long long address){
+    return cacheLookup(cache, address) != NULL;
+}
+
+/**********************************************************************/
+/* Name:        cacheFill                                             */
+/*                                                                    */
+/* Description: This function will store the line of an address that  */
+/*              is not in the cache. It goes to an invalid entry of   */
+/*              the set if there is one, otherwise to the entry       */
+/*              chosen by the replacement policy                      */
+/*                                                                    */
+/* Inputs:      The cache; an address in decimal format; the eviction */
+/*              that will hold a copy of the replaced entry, if it    */
+/*              was valid                                             */
+/*                                                                    */
+/* Outputs:     The entry of the line                                 */
+/**********************************************************************/
+ENGINEFUNCTION
+struct cache *cacheFill(struct cacheEngine *cache, unsigned long long address,
+                        struct eviction *evicted){
+
+    unsigned long long line = address >> cache->offsetBits;
+    unsigned int set = (unsigned int)line & cache->setMask;
+    size_t first = (size_t)set * cache->ways;
+    struct cache *entry = &cache->entries[first];
+    unsigned int j;
+
+    evicted->valid = 0;
+    if(cache->filled[set] < cache->ways){
+        /* The entries are used in order, unless some were invalidated */
+        if(cache->spare != NULL)
+            j = cache->spare[--cache->spareCount];
+        else
+            for(j = 0; cache->states[first + j] == VALID; j++)
+                ;
+        cache->filled[set]++;
+        if(cache->policy == FIFO && cache->newer == NULL)
+            cache->victim[set] = (j + 1 == cache->ways) ? 0 : j + 1;
+    }
+    else{
+        j = policyVictim(cache, set);
+        evicted->valid = 1;
+        evicted->line = entry[j];
+        cache->prefetchUnused += entry[j].prefetched;
+        if(cache->bucket != NULL)
+            hashRemove(cache, j);
+        if(cache->newer != NULL)
+            listUnlink(cache, listOf(cache, j), j);
+    }
+
+    entry[j].coherence = 0;
+    entry[j].dirty = 0;
+    entry[j].prefetched = 0;
+    entry[j].address = line << cache->offsetBits;
+    cache->states[first + j] = VALID;
+    cache->timers[first + j] = cache->timer++;
+    cache->tags[first + j] = entry[j].address;
+    if(cache->bucket != NULL)
+        hashInsert(cache, j);
+    policyTouch(cache, set, j, 1);
+    return &entry[j];
+}
+
+/**********************************************************************/
+/* Name:        cacheInvalidate                                       */
+/*                                                                    */
+/* Description: This function will remove the line of an address from */
+/*              the cache, if it is there                             */
+/*                                                                    */
+/* Inputs:      The cache; an address in decimal format               */
+/*                                                                    */
+/* Outputs:     1 if the line was in the cache, 0 otherwise           */
+/**********************************************************************/
+ENGINEFUNCTION
+int cacheInvalidate(struct cacheEngine *cache, unsigned long long address){
+
+    unsigned long long line = address >> cache->offsetBits;
+    unsigned int set = (unsigned int)line & cache->setMask;
+    unsigned int j = cacheFind(cache, set, line << cache->offsetBits);
+
+    if(j == NOENTRY)
+        return 0;
+    if(cache->bucket != NULL)
+        hashRemove(cache, j);
+    if(cache->newer != NULL)
+        listUnlink(cache, listOf(cache, j), j);
+    if(cache->spare != NULL)
+        cache->spare[cache->spareCount++] = j;
+    cache->states[(size_t)set * cache->ways + j] = INVALID;
+    cache->filled[set]--;
+    return 1;
+}
+
+/**********************************************************************/
+/* Name:        cacheReferenceLine                                    */
+/*                                                                    */
+/* Description: This function will simulate a read or a write of      */
+/*              bytes inside a single line, and count the traffic it  */
+/*              causes with the next level                            */
+/*                                                                    */
+/* Inputs:      The cache; an address in decimal format; the type of  */
+/*              access; the number of bytes                           */
+/*                                                                    */
+/* Outputs:     1 on a hit, 0 on a miss                               */
+/**********************************************************************/
+ENGINEFUNCTION
+int cacheReferenceLine(struct cacheEngine *cache, unsigned long long address, int type,
+                       unsigned int size){
+
+    struct cache *entry = cacheLookup(cache, address);
+    struct eviction evicted;
+    int hit = entry != NULL;
+
+    cache->events++;
+    if(hit)
+        cache->hits++;
+    if(type == WRITE){
+        cache->writes++;
+        cache->writeHits += hit;
+    }
+
+    if(!hit){
+        /* Without write allocate the write goes around the cache */
+        if(type == WRITE && cache->allocate == NOWRITEALLOCATE){
+            cache->writeThroughBytes += size;
+            return 0;
+        }
+        entry = cacheFill(cache, address, &evicted);
+        cache->fillBytes += cache->lineSize;
+        if(evicted.valid && evicted.line.dirty){
+            cache->writebacks++;
+            cache->writebackBytes += cache->lineSize;
+        }
+    }
+
+    if(type == WRITE){
+        if(cache->writePolicy == WRITEBACK)
+            entry->dirty = 1;
+        else
+            cache->writeThroughBytes += size;
+    }
+    return hit;
+}
+
+/**********************************************************************/
+/* Name:        cacheReference                                        */
+/*                                                                    */
+/* Description: This function will simulate a read or a write of a    */
+/*              number of bytes; an access that crosses the end of a  */
+/*              line counts once in every line it touches             */
+/*                                                                    */
+/* Inputs:      The cache; an address in decimal format; the type of  */
+/*              access; the number of bytes, 0 for one line           */
+/*                                                                    */
+/* Outputs:     The number of lines of the access that hit; the       */
+/*              totals are in the counters of the cache               */
+/**********************************************************************/
+ENGINEFUNCTION
+int cacheReference(struct cacheEngine *cache, unsigned long long address, int type, unsigned int size){
+
+    unsigned int offset = address & (cache->lineSize - 1);
+    int hits = 0;
+
+    if(size == 0)
+        size = ACCESSSIZE < cache->lineSize - offset ? ACCESSSIZE : cache->lineSize - offset;
+    while(offset + size > cache->lineSize){
+        unsigned int part = cache->lineSize - offset;
+        hits += cacheReferenceLine(cache, address, type, part);
+        address += part;
+        size -= part;
+        offset = 0;
+    }
+    return hits + cacheReferenceLine(cache, address, type, size);
+}
+
+/**********************************************************************/
+/* Name:        cacheAccess                                           */
+/*                                                                    */
+/* Description: This function will simulate a read of a set           */
+/*              associative cache: on a hit the entry is updated, on  */
+/*              a miss the line is filled                             */
+/*                                                                    */
+/* Inputs:      The cache; an address in decimal format               */
+/*                                                                    */
+/* Outputs:     1 on a hit, 0 on a miss                               */
+/**********************************************************************/
+ENGINEFUNCTION
+int cacheAccess(struct cacheEngine *cache, unsigned long long address){
+    return cacheReferenceLine(cache, address, READ, ACCESSSIZE);
+}
+
+#endif
@@ -0,0 +1,133 @@
+#define _DEFAULT_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "CacheEngine.h"
+#include "Hierarchy.h"
+#include "Trace.h"
+
+#define TRACEBATCH 4096
+
+/**********************************************************************/
+/* Name:        parseLevel                                            */
+/*                                                                    */
+/* Description: This function will read the description of a level:   */
+/*              size:ways:line:latency[:policy[:inclusion]], where    */
+/*              the size is in bytes and may end in K, M or G         */
+/*                                                                    */
+/* Inputs:      The text; the level                                   */
+/*                                                                    */
+/* Outputs:     0 on success, -1 on a malformed or invalid level      */
+/**********************************************************************/
+int parseLevel(const char *text, struct level *level){
+
+    struct cacheConfig config = { 0, 0, 0, LRU, WRITEBACK, WRITEALLOCATE };
+    char  *end;
+    char  name[16];
+
+    unsigned long size = parseSize(text, &end);
+    if(*end++ != ':')
+        return -1;
+    config.ways = (unsigned int)strtoul(end, &end, 0);
+    if(*end++ != ':')
+        return -1;
+    config.lineSize = (unsigned int)strtoul(end, &end, 0);
+    if(*end++ != ':')
+        return -1;
+    level->latency = (unsigned int)strtoul(end, &end, 0);
+    level->inclusion = NINE;
+
+    if(*end == ':'){
+        size_t length = strcspn(++end, ":");
+        if(length >= sizeof(name))
+            return -1;
+        memcpy(name, end, length);
+        name[length] = '\0';
+        config.policy = policyName(name);
+        end += length;
+        if(*end == ':'){
+            level->inclusion = inclusionName(++end);
+            end += strlen(end);
+        }
+    }
+    if(*end != '\0' || level->inclusion < 0 || config.ways == 0 || config.lineSize == 0)
+        return -1;
+
+    /* The sets follow from the size, ways and line size */
+    if(size % ((unsigned long)config.ways * config.lineSize) != 0)
+        return -1;
+    config.sets = (unsigned int)(size / ((unsigned long)config.ways * config.lineSize));
+    return cacheInit(&level->cache, &config);
+}
+
+int main(int argc, char *argv[]){
+
+    /* A typical three level hierarchy when no level is given */
+    static const char *defaults[] = { "32K:8:64:4", "256K:8:64:12:lru:nine",
+                                      "8M:16:64:40:lru:inclusive" };
+    static struct hierarchy hierarchy;
+    const char   *traceName = "trace.txt";
+    const char   *levels[MAXLEVELS];
+    int          count = 0;
+    int          option;
+
+    struct trace trace;
+    unsigned int batch[TRACEBATCH];
+    size_t       n;
+
+    hierarchy.memoryLatency = 200;
+    while((option = getopt(argc, argv, "l:m:")) != -1){
+        switch(option){
+          case 'l':
+              if(count == MAXLEVELS){
+                  fprintf(stderr, "%s: at most %d levels\n", argv[0], MAXLEVELS);
+                  return 1;
+              }
+              levels[count++] = optarg;
+              break;
+          case 'm':
+              hierarchy.memoryLatency = (unsigned int)strtoul(optarg, NULL, 0);
+              break;
+          default :
+              fprintf(stderr, "usage: %s [-l size:ways:line:latency[:policy[:inclusion]]]... "
+                      "[-m memory latency] [trace file]\n", argv[0]);
+              fprintf(stderr, "  the first -l is L1; inclusion is nine, inclusive or exclusive\n");
+              return 1;
+        }
+    }
+    if(optind < argc)
+        traceName = argv[optind];
+    if(count == 0){
+        for(count = 0; count < 3; count++)
+            levels[count] = defaults[count];
+    }
+
+    for(hierarchy.count = 0; hierarchy.count < count; hierarchy.count++){
+        if(parseLevel(levels[hierarchy.count], &hierarchy.levels[hierarchy.count]) != 0){
+            fprintf(stderr, "%s: invalid level %s\n", argv[0], levels[hierarchy.count]);
+            return 1;
+        }
+    }
+
+    if(traceOpen(&trace, traceName) != 0){
+        fprintf(stderr, "%s: cannot read %s\n", argv[0], traceName);
+        return 1;
+    }
+    while((n = traceRead(&trace, batch, TRACEBATCH)) > 0)
+        for(size_t i = 0; i < n; i++)
+            hierarchyAccess(&hierarchy, batch[i]);
+    if(traceClose(&trace) != 0){
+        fprintf(stderr, "%s: %s is truncated or corrupt\n", argv[0], traceName);
+        for(int i = 0; i < hierarchy.count; i++)
+            cacheFree(&hierarchy.levels[i].cache);
+        return 1;
+    }
+
+    hierarchyStatistics(&hierarchy);
+    for(int i = 0; i < hierarchy.count; i++)
+        cacheFree(&hierarchy.levels[i].cache);
+    return 0;
+}
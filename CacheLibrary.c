@@ -0,0 +1,149 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "CacheLibrary.h"
+
+/* The engine is compiled into the library with internal linkage, so its
+functions cannot clash with the program that links it */
+#define ENGINE_PRIVATE
+#include "CacheEngine.h"
+
+struct cacheHandle{
+    struct cacheEngine          cache;
+    struct cacheBatchStatistics totals;
+};
+
+/**********************************************************************/
+/* Name:        cacheCreate                                           */
+/*                                                                    */
+/* Description: This function will allocate a cache from the names of */
+/*              its policies                                          */
+/*                                                                    */
+/* Inputs:      The sets; the ways; the line size; the replacement,   */
+/*              write and allocation policies, NULL for the default   */
+/*                                                                    */
+/* Outputs:     The cache, NULL on a bad configuration or no memory   */
+/**********************************************************************/
+struct cacheHandle *cacheCreate(unsigned int sets, unsigned int ways, unsigned int lineSize,
+                                const char *policy, const char *writePolicy,
+                                const char *allocate){
+
+    struct cacheConfig config = { sets, ways, lineSize, FIFO, WRITEBACK, WRITEALLOCATE };
+    struct cacheHandle *handle;
+
+    if(policy != NULL)
+        config.policy = policyName(policy);
+    if(writePolicy != NULL)
+        config.writePolicy = namedValue(writePolicy, writePolicyNames, 2);
+    if(allocate != NULL)
+        config.allocate = namedValue(allocate, allocatePolicyNames, 2);
+
+    handle = calloc(1, sizeof(*handle));
+    if(handle == NULL)
+        return NULL;
+    if(cacheInit(&handle->cache, &config) != 0){
+        free(handle);
+        return NULL;
+    }
+    return handle;
+}
+
+/**********************************************************************/
+/* Name:        cacheDestroy                                          */
+/*                                                                    */
+/* Description: This function will release a cache                    */
+/*                                                                    */
+/* Inputs:      The cache, or NULL                                    */
+/*                                                                    */
+/* Outputs:     NONE                                                  */
+/**********************************************************************/
+void cacheDestroy(struct cacheHandle *handle){
+    if(handle == NULL)
+        return;
+    cacheFree(&handle->cache);
+    free(handle);
+}
+
+/**********************************************************************/
+/* Name:        cacheAccessBatch                                      */
+/*                                                                    */
+/* Description: This function will simulate a batch of accesses and   */
+/*              count them from the difference of the counters of the */
+/*              engine before and after it                            */
+/*                                                                    */
+/* Inputs:      The cache; the addresses; their types and sizes, or   */
+/*              NULL; their number; the statistics of the batch and   */
+/*              the hit bitmap, or NULL                               */
+/*                                                                    */
+/* Outputs:     The hits of the batch                                 */
+/**********************************************************************/
+unsigned long long cacheAccessBatch(struct cacheHandle *handle,
+                                    const unsigned long long addresses[],
+                                    const unsigned char types[], const unsigned char sizes[],
+                                    size_t count, struct cacheBatchStatistics *statistics,
+                                    unsigned char *hitBitmap){
+
+    struct cacheEngine *cache = &handle->cache;
+    struct cacheBatchStatistics batch;
+    unsigned long long hits = cache->hits;
+    unsigned long long events = cache->events;
+    unsigned long long writes = cache->writes;
+    unsigned long long writebacks = cache->writebacks;
+    unsigned long long fillBytes = cache->fillBytes;
+    unsigned long long writebackBytes = cache->writebackBytes;
+    unsigned long long writeThroughBytes = cache->writeThroughBytes;
+
+    /* The plain case stays a tight loop */
+    if(types == NULL && sizes == NULL && hitBitmap == NULL)
+        for(size_t i = 0; i < count; i++)
+            cacheReferenceLine(cache, addresses[i], READ, ACCESSSIZE);
+    else{
+        if(hitBitmap != NULL)
+            memset(hitBitmap, 0, (count + 7) / 8);
+        for(size_t i = 0; i < count; i++){
+            int type = types != NULL ? types[i] : READ;
+            unsigned long long before = cache->events - cache->hits;
+            if(sizes != NULL)
+                cacheReference(cache, addresses[i], type, sizes[i]);
+            else
+                cacheReferenceLine(cache, addresses[i], type, ACCESSSIZE);
+            if(hitBitmap != NULL && cache->events - cache->hits == before)
+                hitBitmap[i >> 3] |= (unsigned char)(1u << (i & 7));
+        }
+    }
+
+    batch.accesses = cache->events - events;
+    batch.hits = cache->hits - hits;
+    batch.misses = batch.accesses - batch.hits;
+    batch.writes = cache->writes - writes;
+    batch.writebacks = cache->writebacks - writebacks;
+    batch.fillBytes = cache->fillBytes - fillBytes;
+    batch.writebackBytes = cache->writebackBytes - writebackBytes;
+    batch.writeThroughBytes = cache->writeThroughBytes - writeThroughBytes;
+
+    handle->totals.accesses += batch.accesses;
+    handle->totals.hits += batch.hits;
+    handle->totals.misses += batch.misses;
+    handle->totals.writes += batch.writes;
+    handle->totals.writebacks += batch.writebacks;
+    handle->totals.fillBytes += batch.fillBytes;
+    handle->totals.writebackBytes += batch.writebackBytes;
+    handle->totals.writeThroughBytes += batch.writeThroughBytes;
+    if(statistics != NULL)
+        *statistics = batch;
+    return batch.hits;
+}
+
+/**********************************************************************/
+/* Name:        cacheTotals                                           */
+/*                                                                    */
+/* Description: This function will copy the counters of every access  */
+/*              since the cache was created                           */
+/*                                                                    */
+/* Inputs:      The cache; the statistics                             */
+/*                                                                    */
+/* Outputs:     NONE                                                  */
+/**********************************************************************/
+void cacheTotals(const struct cacheHandle *handle, struct cacheBatchStatistics *statistics){
+    *statistics = handle->totals;
+}
@@ -0,0 +1,56 @@
+#ifndef CACHE_LIBRARY_H
+#define CACHE_LIBRARY_H
+
+#include <stddef.h>
+
+/* Interface of the simulator as a library, built from CacheLibrary.c:
+
+    gcc -std=gnu11 -O2 -fPIC -c CacheLibrary.c
+
+The cache is an opaque handle, so programs that link it only include this
+header; policies are given by the names the simulators take on their
+command lines */
+struct cacheHandle;
+
+/* Counters of a batch of accesses, or of every access since the cache
+was created. An access that crosses a line counts once per line */
+struct cacheBatchStatistics{
+    unsigned long long accesses;
+    unsigned long long hits;
+    unsigned long long misses;
+    unsigned long long writes;
+    unsigned long long writebacks;          /* Dirty lines evicted */
+    unsigned long long fillBytes;           /* Read from the next level */
+    unsigned long long writebackBytes;      /* Written back to the next level */
+    unsigned long long writeThroughBytes;   /* Written through to the next level */
+};
+
+/* Creates a cache of sets * ways lines. The sets and the line size must be
+powers of two; policy is fifo, lru, plru, rrip or random, writePolicy is
+writeback or writethrough and allocate is allocate or noallocate, and any
+of them may be NULL for the first one. Returns NULL on a bad configuration
+or when there is no memory */
+struct cacheHandle *cacheCreate(unsigned int sets, unsigned int ways, unsigned int lineSize,
+                                const char *policy, const char *writePolicy,
+                                const char *allocate);
+
+/* Releases a cache */
+void cacheDestroy(struct cacheHandle *handle);
+
+/* Simulates count accesses. Types are 0 for reads and 1 for writes and
+sizes are in bytes; without types every access is a read and without sizes
+every access touches a single line. If statistics is not NULL it receives
+the counters of this batch. If hitBitmap is not NULL it receives one bit
+per access, least significant first, set when every line the access
+touched hit; it must have room for (count + 7) / 8 bytes. Returns the hits
+of the batch */
+unsigned long long cacheAccessBatch(struct cacheHandle *handle,
+                                    const unsigned long long addresses[],
+                                    const unsigned char types[], const unsigned char sizes[],
+                                    size_t count, struct cacheBatchStatistics *statistics,
+                                    unsigned char *hitBitmap);
+
+/* Copies the counters of every access since the cache was created */
+void cacheTotals(const struct cacheHandle *handle, struct cacheBatchStatistics *statistics);
+
+#endif
@@ -0,0 +1,325 @@
+#ifndef CACHE_OUTPUT_H
+#define CACHE_OUTPUT_H
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "CacheEngine.h"
+
+/* Formats of the final statistics: the table of the entries followed by
+the counters as text, or a single JSON object or CSV record */
+enum outputFormat { TABLE = 0, JSON, CSV };
+
+const char *outputFormatNames[] = { "table", "json", "csv" };
+
+/* The table of the entries is only printed up to this many entries;
+larger caches are better dumped with cacheDump */
+#define TABLEENTRIES 4096
+
+/* The dump starts with DUMPMAGIC, a version and its header words; then one
+record of DUMPRECORD bytes per valid line: the entry number, the address,
+the timer and a byte of flags, 1 for dirty and 2 for prefetched. Numbers
+are 32 and 64 bit little endian; version 1 had a 32 bit timer */
+#define DUMPMAGIC   "CDMP"
+#define DUMPVERSION 2
+#define DUMPHEADER  24
+#define DUMPRECORD  21
+
+/* Text built in memory, so that it is written in a single call */
+struct outputBuffer{
+    char   *data;
+    size_t size;
+    size_t capacity;
+    int    failed;      /* 1 once memory ran out */
+};
+
+/**********************************************************************/
+/* Name:        outputReserve                                         */
+/*                                                                    */
+/* Description: This function will make room for more bytes at the    */
+/*              end of an output buffer                               */
+/*                                                                    */
+/* Inputs:      The buffer; the bytes needed                          */
+/*                                                                    */
+/* Outputs:     0 on success, -1 if there is no memory                */
+/**********************************************************************/
+int outputReserve(struct outputBuffer *out, size_t bytes){
+
+    size_t capacity = out->capacity ? out->capacity : 65536;
+
+    if(out->failed)
+        return -1;
+    if(out->size + bytes <= out->capacity)
+        return 0;
+    while(capacity < out->size + bytes)
+        capacity *= 2;
+    char *data = realloc(out->data, capacity);
+    if(data == NULL){
+        out->failed = 1;
+        return -1;
+    }
+    out->data = data;
+    out->capacity = capacity;
+    return 0;
+}
+
+/**********************************************************************/
+/* Name:        outputPrintf                                          */
+/*                                                                    */
+/* Description: This function will append formatted text to an output */
+/*              buffer                                                */
+/*                                                                    */
+/* Inputs:      The buffer; the format and its arguments, as printf   */
+/*                                                                    */
+/* Outputs:     NONE                                                  */
+/**********************************************************************/
+void outputPrintf(struct outputBuffer *out, const char *format, ...){
+
+    va_list arguments;
+    int length;
+
+    va_start(arguments, format);
+    length = vsnprintf(NULL, 0, format, arguments);
+    va_end(arguments);
+    if(length < 0 || outputReserve(out, (size_t)length + 1) != 0)
+        return;
+    va_start(arguments, format);
+    vsnprintf(out->data + out->size, (size_t)length + 1, format, arguments);
+    va_end(arguments);
+    out->size += (size_t)length;
+}
+
+/**********************************************************************/
+/* Name:        outputFlush                                           */
+/*                                                                    */
+/* Description: This function will write an output buffer in a single  */
+/*              call and release it                                   */
+/*                                                                    */
+/* Inputs:      The buffer; the file                                  */
+/*                                                                    */
+/* Outputs:     0 on success, -1 on a write error or if memory ran    */
+/*              out while the buffer was built                        */
+/**********************************************************************/
+int outputFlush(struct outputBuffer *out, FILE *fp){
+
+    int status = out->failed ? -1 : 0;
+
+    if(out->size > 0 && fwrite(out->data, 1, out->size, fp) != out->size)
+        status = -1;
+    fflush(fp);
+    free(out->data);
+    memset(out, 0, sizeof(*out));
+    return status;
+}
+
+/**********************************************************************/
+/* Name:        header                                                */
+/*                                                                    */
+/* Description: This function will print the header structure of the  */
+/*              table which presents the information of the cache     */
+/*                                                                    */
+/* Inputs:      The output buffer; the title of the table             */
+/*                                                                    */
+/* Outputs:     NONE                                                  */
+/**********************************************************************/
+void header(struct outputBuffer *out, const char *title){
+
+    /* Center the title inside the 39 columns of the table */
+    int width = 39;
+    int length = (int)strlen(title);
+    int left = (width - length)/2;
+    int right = width - length - left;
+
+    outputPrintf(out, "-----------------------------------------\n");
+    outputPrintf(out, "|%*s%s%*s|\n", left, "", title, right, "");
+    outputPrintf(out, "|                                       |\n-----------------------------------------\n");
+    outputPrintf(out, "| ENTRY | ADDRESS | STATUS  | LAST USED |\n");
+    outputPrintf(out, "-----------------------------------------\n");
+}
+
+/**********************************************************************/
+/* Name:        cacheStatistics                                       */
+/*                                                                    */
+/* Description: This function will print the number hits, misses and  */
+/*              and the hit rate                                      */
+/*                                                                    */
+/* Inputs:      The number of hits, misses, and the hit rate          */
+/*                                                                    */
+/* Outputs:     NONE                                                  */
+/**********************************************************************/
+void cacheStatistics(unsigned long long hits, unsigned long long events, double hitRate){
+    printf("-----------------------------------------\n");
+    printf("|   HITS    |   MISSES   |   HIT RATE   |\n");
+    printf("-----------------------------------------\n");
+    printf("| %9llu | %10llu | p = %.6f |\n", hits, events-hits, hitRate);
+    printf("-----------------------------------------\n\n");
+}
+
+/**********************************************************************/
+/* Name:        printCache                                            */
+/*                                                                    */
+/* Description: This function will print a table of the entries of a  */
+/*              cache, or only their number when there are more than  */
+/*              TABLEENTRIES                                          */
+/*                                                                    */
+/* Inputs:      The cache; the title of the table                     */
+/*                                                                    */
+/* Outputs:     NONE                                                  */
+/**********************************************************************/
+void printCache(struct cacheEngine *cache, const char *title){
+
+    size_t size = (size_t)cache->sets * cache->ways;
+    struct outputBuffer out = { NULL, 0, 0, 0 };
+
+    if(size > TABLEENTRIES){
+        printf("%s of %zu entries, too many for a table; -D dumps the valid ones\n\n",
+               title, size);
+        return;
+    }
+
+    header(&out, title);
+    for(size_t i = 0; i < size; i++){
+        const struct cache *entry = &cache->entries[i];
+        const char *status = "INVALID";
+        if(cache->states[i] == VALID)
+            status = entry->dirty ? "DIRTY" : "VALID";
+        outputPrintf(&out, "| %04zu  | %04llX    | %-7s |  %8llu |\n", i, entry->address, status,
+                     cache->timers[i]);
+    }
+    outputPrintf(&out, "-----------------------------------------\n\n");
+    outputFlush(&out, stdout);
+}
+
+/**********************************************************************/
+/* Name:        printRecord                                           */
+/*                                                                    */
+/* Description: This function will print the configuration and the    */
+/*              counters of a cache as a JSON object or as a CSV      */
+/*              header and record                                     */
+/*                                                                    */
+/* Inputs:      The cache; the format; the name of the cache; the     */
+/*              hit rate estimated by sampling and its 95% interval,  */
+/*              the exact hit rate three times without sampling       */
+/*                                                                    */
+/* Outputs:     NONE                                                  */
+/**********************************************************************/
+void printRecord(struct cacheEngine *cache, int format, const char *title,
+                 const double estimate[3]){
+
+    struct outputBuffer out = { NULL, 0, 0, 0 };
+    unsigned long long counters[] = {
+        cache->events, cache->hits, cache->events - cache->hits, cache->events - cache->writes,
+        cache->writes, cache->writeHits, cache->writebacks, cache->fillBytes,
+        cache->writebackBytes, cache->writeThroughBytes, cache->prefetches,
+        cache->prefetchHits, cache->prefetchLate, cache->prefetchUnused
+    };
+    const char *names[] = {
+        "accesses", "hits", "misses", "reads", "writes", "writeHits", "writebacks",
+        "fillBytes", "writebackBytes", "writeThroughBytes", "prefetches", "prefetchHits",
+        "prefetchLate", "prefetchUnused"
+    };
+    const int count = (int)(sizeof(names) / sizeof(names[0]));
+    double hitRate = cache->events ? cache->hits/(double)cache->events : 0.0;
+
+    if(format == JSON){
+        outputPrintf(&out, "{\"cache\": \"%s\", \"sets\": %u, \"ways\": %u, \"lineSize\": %u, "
+                     "\"policy\": \"%s\", \"writePolicy\": \"%s\", \"allocate\": \"%s\"",
+                     title, cache->sets, cache->ways, cache->lineSize,
+                     policyNames[cache->policy], writePolicyNames[cache->writePolicy],
+                     allocatePolicyNames[cache->allocate]);
+        for(int i = 0; i < count; i++)
+            outputPrintf(&out, ", \"%s\": %llu", names[i], counters[i]);
+        outputPrintf(&out, ", \"hitRate\": %.6f, \"estimatedHitRate\": %.6f, "
+                     "\"estimateLower\": %.6f, \"estimateUpper\": %.6f}\n",
+                     hitRate, estimate[0], estimate[1], estimate[2]);
+    }
+    else{
+        outputPrintf(&out, "cache,sets,ways,lineSize,policy,writePolicy,allocate");
+        for(int i = 0; i < count; i++)
+            outputPrintf(&out, ",%s", names[i]);
+        outputPrintf(&out, ",hitRate,estimatedHitRate,estimateLower,estimateUpper\n");
+        outputPrintf(&out, "%s,%u,%u,%u,%s,%s,%s", title, cache->sets, cache->ways,
+                     cache->lineSize, policyNames[cache->policy],
+                     writePolicyNames[cache->writePolicy], allocatePolicyNames[cache->allocate]);
+        for(int i = 0; i < count; i++)
+            outputPrintf(&out, ",%llu", counters[i]);
+        outputPrintf(&out, ",%.6f,%.6f,%.6f,%.6f\n", hitRate, estimate[0], estimate[1],
+                     estimate[2]);
+    }
+    outputFlush(&out, stdout);
+}
+
+/**********************************************************************/
+/* Name:        putLittleEndian                                       */
+/*                                                                    */
+/* Description: This function will store a number in little endian    */
+/*              order                                                 */
+/*                                                                    */
+/* Inputs:      The destination; the number; its bytes               */
+/*                                                                    */
+/* Outputs:     NONE                                                  */
+/**********************************************************************/
+void putLittleEndian(unsigned char *p, unsigned long long value, int bytes){
+    for(int i = 0; i < bytes; i++)
+        p[i] = (unsigned char)(value >> (8 * i));
+}
+
+/**********************************************************************/
+/* Name:        cacheDump                                             */
+/*                                                                    */
+/* Description: This function will write the valid lines of a cache   */
+/*              to a file in a single write, skipping the invalid     */
+/*              ones                                                  */
+/*                                                                    */
+/* Inputs:      The cache; the name of the file                       */
+/*                                                                    */
+/* Outputs:     0 on success, -1 on a write error or no memory        */
+/**********************************************************************/
+int cacheDump(struct cacheEngine *cache, const char *name){
+
+    size_t size = (size_t)cache->sets * cache->ways;
+    size_t valid = 0;
+    unsigned char *buffer, *p;
+    FILE *fp;
+    int status = 0;
+
+    for(size_t i = 0; i < size; i++)
+        valid += cache->states[i] == VALID;
+    buffer = malloc(DUMPHEADER + valid * DUMPRECORD);
+    if(buffer == NULL)
+        return -1;
+
+    memcpy(buffer, DUMPMAGIC, 4);
+    putLittleEndian(buffer + 4, DUMPVERSION, 4);
+    putLittleEndian(buffer + 8, cache->sets, 4);
+    putLittleEndian(buffer + 12, cache->ways, 4);
+    putLittleEndian(buffer + 16, cache->lineSize, 4);
+    putLittleEndian(buffer + 20, valid, 4);
+    p = buffer + DUMPHEADER;
+    for(size_t i = 0; i < size; i++){
+        const struct cache *entry = &cache->entries[i];
+        if(cache->states[i] != VALID)
+            continue;
+        putLittleEndian(p, i, 4);
+        putLittleEndian(p + 4, entry->address, 8);
+        putLittleEndian(p + 12, cache->timers[i], 8);
+        p[20] = (unsigned char)(entry->dirty | entry->prefetched << 1);
+        p += DUMPRECORD;
+    }
+
+    fp = fopen(name, "wb");
+    if(fp == NULL)
+        status = -1;
+    else{
+        if(fwrite(buffer, 1, (size_t)(p - buffer), fp) != (size_t)(p - buffer))
+            status = -1;
+        if(fclose(fp) != 0)
+            status = -1;
+    }
+    free(buffer);
+    return status;
+}
+
+#endif
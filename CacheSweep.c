@@ -0,0 +1,355 @@
+#define _DEFAULT_SOURCE
+
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <stdatomic.h>
+
+#include "CacheEngine.h"
+#include "Kernels.h"
+#include "Trace.h"
+
+#define MAXVALUES  32
+#define MAXWORKERS 256
+
+/* One configuration of the grid and its result */
+struct job{
+    struct cacheConfig config;
+    unsigned long long size;        /* Capacity in bytes */
+    unsigned long long hits;
+    unsigned long long events;
+    int                status;      /* 0 if the configuration was simulated */
+};
+
+/* The jobs of a worker. The range holds the first job not yet taken in
+the high half and the end of the range in the low half, so the owner can
+take from the end and thieves from the start with a single compare and
+swap; it is alone in its cache line so the workers do not share lines */
+struct deque{
+    _Atomic unsigned long long range;
+    char               padding[64 - sizeof(unsigned long long)];
+};
+
+/* State shared by the workers; the trace is only read */
+struct sweep{
+    const unsigned int *addresses;
+    size_t             events;
+    struct job         *jobs;
+    struct deque       deques[MAXWORKERS];
+    int                workers;
+};
+
+struct worker{
+    struct sweep *sweep;
+    int          id;
+};
+
+/**********************************************************************/
+/* Name:        parseList                                             */
+/*                                                                    */
+/* Description: This function will read a comma separated list of     */
+/*              numbers or of policy names                            */
+/*                                                                    */
+/* Inputs:      The text; an array for the values; 1 for policies;    */
+/*              the largest number allowed                            */
+/*                                                                    */
+/* Outputs:     The number of values, -1 on a malformed list or a     */
+/*              number above the limit                                */
+/**********************************************************************/
+int parseList(const char *text, unsigned long long values[], int policies,
+              unsigned long long limit){
+
+    int n = 0;
+    char item[32];
+
+    while(*text != '\0' && n < MAXVALUES){
+        size_t length = strcspn(text, ",");
+        if(length == 0 || length >= sizeof(item))
+            return -1;
+        memcpy(item, text, length);
+        item[length] = '\0';
+
+        if(policies){
+            int policy = policyName(item);
+            if(policy < 0)
+                return -1;
+            values[n++] = (unsigned long long)policy;
+        }
+        else{
+            char *end;
+            values[n] = parseSize(item, &end);
+            if(*end != '\0' || values[n++] > limit)
+                return -1;
+        }
+        text += length;
+        if(*text == ',')
+            text++;
+    }
+    return n;
+}
+
+/**********************************************************************/
+/* Name:        loadTrace                                             */
+/*                                                                    */
+/* Description: This function will decode a whole trace into memory    */
+/*              so every configuration reads the same buffer          */
+/*                                                                    */
+/* Inputs:      The name of the trace; the number of addresses read   */
+/*                                                                    */
+/* Outputs:     The addresses, NULL if the trace cannot be read or is */
+/*              corrupt                                               */
+/**********************************************************************/
+unsigned int *loadTrace(const char *name, size_t *events){
+
+    struct trace trace;
+    size_t       capacity = 1 << 20;
+    size_t       count;
+    unsigned int *addresses;
+
+    *events = 0;
+    if(traceOpen(&trace, name) != 0)
+        return NULL;
+    addresses = malloc(capacity * sizeof(unsigned int));
+
+    while(addresses != NULL){
+        if(*events == capacity){
+            unsigned int *grown = realloc(addresses, 2 * capacity * sizeof(unsigned int));
+            if(grown == NULL){
+                free(addresses);
+                addresses = NULL;
+                break;
+            }
+            addresses = grown;
+            capacity *= 2;
+        }
+        count = traceRead(&trace, addresses + *events, capacity - *events);
+        if(count == 0)
+            break;
+        *events += count;
+    }
+
+    if(traceClose(&trace) != 0){
+        free(addresses);
+        addresses = NULL;
+    }
+    return addresses;
+}
+
+/**********************************************************************/
+/* Name:        takeJob                                               */
+/*                                                                    */
+/* Description: This function will take a job from either end of the  */
+/*              range of a worker                                     */
+/*                                                                    */
+/* Inputs:      The deque; 1 to take from the end (the owner), 0 to   */
+/*              take from the start (a thief)                         */
+/*                                                                    */
+/* Outputs:     The job, -1 if the range is empty                     */
+/**********************************************************************/
+long takeJob(struct deque *deque, int owner){
+
+    unsigned long long range = atomic_load(&deque->range);
+    for(;;){
+        unsigned long long top = range >> 32;
+        unsigned long long bottom = range & 0xffffffffu;
+        if(top >= bottom)
+            return -1;
+
+        unsigned long long next = owner ? (top << 32) | (bottom - 1)
+                                        : ((top + 1) << 32) | bottom;
+        if(atomic_compare_exchange_weak(&deque->range, &range, next))
+            return owner ? (long)(bottom - 1) : (long)top;
+    }
+}
+
+/**********************************************************************/
+/* Name:        runJob                                                */
+/*                                                                    */
+/* Description: This function will simulate one configuration over    */
+/*              the shared trace with the kernel chosen for it        */
+/*                                                                    */
+/* Inputs:      The sweep; the job                                    */
+/*                                                                    */
+/* Outputs:     NONE                                                  */
+/**********************************************************************/
+void runJob(struct sweep *sweep, struct job *job){
+
+    struct cacheEngine cache;
+
+    if(cacheInit(&cache, &job->config) != 0){
+        job->status = -1;
+        return;
+    }
+    kernelSelect(&cache)(&cache, sweep->addresses, sweep->events);
+
+    job->hits = cache.hits;
+    job->events = cache.events;
+    job->status = 0;
+    cacheFree(&cache);
+}
+
+/**********************************************************************/
+/* Name:        workerMain                                            */
+/*                                                                    */
+/* Description: This function will run the jobs of a worker and then  */
+/*              steal jobs from the other workers until none is left  */
+/*                                                                    */
+/* Inputs:      The worker                                            */
+/*                                                                    */
+/* Outputs:     NULL                                                  */
+/**********************************************************************/
+void *workerMain(void *argument){
+
+    struct worker *worker = argument;
+    struct sweep *sweep = worker->sweep;
+    long job;
+
+    for(;;){
+        job = takeJob(&sweep->deques[worker->id], 1);
+        for(int i = 1; job < 0 && i < sweep->workers; i++)
+            job = takeJob(&sweep->deques[(worker->id + i) % sweep->workers], 0);
+        if(job < 0)
+            break;
+        runJob(sweep, &sweep->jobs[job]);
+    }
+    return NULL;
+}
+
+int main(int argc, char *argv[]){
+
+    unsigned long long sizes[MAXVALUES] = { 16 };
+    unsigned long long ways[MAXVALUES] = { 1 };
+    unsigned long long lineSizes[MAXVALUES] = { 1 };
+    unsigned long long policies[MAXVALUES] = { FIFO };
+    int          nSizes = 1, nWays = 1, nLineSizes = 1, nPolicies = 1;
+    int          workers = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    const char   *traceName = "trace.txt";
+    int          option;
+
+    static struct sweep sweep;
+    struct worker       worker[MAXWORKERS];
+    pthread_t           thread[MAXWORKERS];
+    int                 started[MAXWORKERS];
+
+    while((option = getopt(argc, argv, "S:w:b:p:j:")) != -1){
+        int n = 0;
+        switch(option){
+          case 'S':
+              n = nSizes = parseList(optarg, sizes, 0, ULLONG_MAX);
+              break;
+          case 'w':
+              n = nWays = parseList(optarg, ways, 0, UINT_MAX);
+              break;
+          case 'b':
+              n = nLineSizes = parseList(optarg, lineSizes, 0, UINT_MAX);
+              break;
+          case 'p':
+              n = nPolicies = parseList(optarg, policies, 1, RANDOM);
+              break;
+          case 'j':
+              n = workers = atoi(optarg);
+              break;
+          default :
+              n = -1;
+        }
+        if(n <= 0){
+            fprintf(stderr, "usage: %s [-S sizes] [-w ways] [-b line sizes] [-p policies] "
+                    "[-j threads] [trace file]\n", argv[0]);
+            fprintf(stderr, "  lists are comma separated, e.g. -S 32K,1M -w 1,8 -p lru,rrip\n");
+            return 1;
+        }
+    }
+    if(optind < argc)
+        traceName = argv[optind];
+    if(workers > MAXWORKERS)
+        workers = MAXWORKERS;
+
+    /* Decode the trace once for every configuration */
+    double start = wallClock();
+    sweep.addresses = loadTrace(traceName, &sweep.events);
+    if(sweep.addresses == NULL){
+        fprintf(stderr, "%s: cannot read %s\n", argv[0], traceName);
+        return 1;
+    }
+    double loaded = wallClock();
+
+    /* Build the grid; the sets follow from the size, ways and line size */
+    size_t jobs = (size_t)nSizes * nWays * nLineSizes * nPolicies;
+    sweep.jobs = calloc(jobs, sizeof(struct job));
+    if(sweep.jobs == NULL)
+        return 1;
+    size_t n = 0;
+    for(int s = 0; s < nSizes; s++)
+        for(int w = 0; w < nWays; w++)
+            for(int b = 0; b < nLineSizes; b++)
+                for(int p = 0; p < nPolicies; p++){
+                    /* A grid point with more sets than an engine can
+                    index gets no sets, and is reported invalid */
+                    struct job *job = &sweep.jobs[n++];
+                    unsigned long long lines = lineSizes[b] ? sizes[s] / lineSizes[b] : 0;
+                    job->size = sizes[s];
+                    job->config.ways = (unsigned int)ways[w];
+                    job->config.lineSize = (unsigned int)lineSizes[b];
+                    job->config.policy = (int)policies[p];
+                    job->config.sets = (ways[w] != 0 && lines % ways[w] == 0 &&
+                                        lines / ways[w] <= UINT_MAX) ?
+                                       (unsigned int)(lines / ways[w]) : 0;
+                }
+
+    /* Give every worker a contiguous share of the grid */
+    if((size_t)workers > jobs)
+        workers = (int)jobs;
+    sweep.workers = workers;
+    for(int i = 0; i < workers; i++){
+        unsigned long long first = jobs * i / workers;
+        unsigned long long last = jobs * (i + 1) / workers;
+        atomic_init(&sweep.deques[i].range, (first << 32) | last);
+    }
+    for(int i = 0; i < workers; i++){
+        worker[i].sweep = &sweep;
+        worker[i].id = i;
+        started[i] = pthread_create(&thread[i], NULL, workerMain, &worker[i]) == 0;
+    }
+
+    /* The jobs of a worker that did not start are stolen by the others;
+    the main thread takes its place so they run even if no thread started */
+    for(int i = 0; i < workers; i++)
+        if(!started[i]){
+            fprintf(stderr, "%s: cannot start thread %d, the main thread takes its place\n",
+                    argv[0], i);
+            workerMain(&worker[i]);
+            break;
+        }
+    for(int i = 0; i < workers; i++)
+        if(started[i])
+            pthread_join(thread[i], NULL);
+    double finished = wallClock();
+
+    printf("-----------------------------------------------------------------------------\n");
+    printf("|    SIZE    |  SETS   |  WAYS  |  LINE  | POLICY |     HITS     | HIT RATE |\n");
+    printf("-----------------------------------------------------------------------------\n");
+    for(size_t i = 0; i < jobs; i++){
+        struct job *job = &sweep.jobs[i];
+        if(job->status != 0){
+            printf("| %10llu | %7s | %6u | %6u | %-6s | %12s | %8s |\n", job->size, "-",
+                   job->config.ways, job->config.lineSize, policyNames[job->config.policy],
+                   "invalid", "-");
+            continue;
+        }
+        printf("| %10llu | %7u | %6u | %6u | %-6s | %12llu | %.6f |\n", job->size,
+               job->config.sets, job->config.ways, job->config.lineSize,
+               policyNames[job->config.policy], job->hits,
+               job->events ? job->hits/(double)job->events : 0.0);
+    }
+    printf("-----------------------------------------------------------------------------\n");
+    printf("%zu configurations x %zu accesses on %d threads: load %.3f s, simulation %.3f s "
+           "(%.1f M accesses/s)\n", jobs, sweep.events, workers, loaded - start, finished - loaded,
+           jobs * (double)sweep.events / 1e6 / (finished - loaded));
+
+    free(sweep.jobs);
+    free((void *)sweep.addresses);
+    return 0;
+}
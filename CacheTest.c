@@ -0,0 +1,456 @@
+#include <stdio.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "CacheLibrary.h"
+#include "Checkpoint.h"
+#include "Classification.h"
+#include "Prefetch.h"
+#include "Profile.h"
+#include "StackDistance.h"
+#include "TraceRing.h"
+
+/* Checks of the library and of the headers of the simulators; build it
+with the library:
+
+    gcc -std=gnu11 -O2 -pthread -o CacheTest CacheTest.c CacheLibrary.c -lm
+*/
+
+/**********************************************************************/
+/* Name:        checkColdKey                                          */
+/*                                                                    */
+/* Description: This function will access a key twice in a new cache, */
+/*              which must miss and then hit                          */
+/*                                                                    */
+/* Inputs:      The geometry and the policy of the cache; the key     */
+/*                                                                    */
+/* Outputs:     0 if the cache behaves, 1 otherwise                   */
+/**********************************************************************/
+int checkColdKey(unsigned int sets, unsigned int ways, unsigned int lineSize, const char *policy,
+                 unsigned long long key){
+
+    struct cacheHandle *handle = cacheCreate(sets, ways, lineSize, policy, NULL, NULL);
+    unsigned long long first, second;
+
+    if(handle == NULL){
+        printf("FAIL %u sets, %u ways, %u byte lines, %s: cannot create\n", sets, ways,
+               lineSize, policy);
+        return 1;
+    }
+    first = cacheAccessBatch(handle, &key, NULL, NULL, 1, NULL, NULL);
+    second = cacheAccessBatch(handle, &key, NULL, NULL, 1, NULL, NULL);
+    cacheDestroy(handle);
+    if(first == 0 && second == 1)
+        return 0;
+    printf("FAIL %u sets, %u ways, %u byte lines, %s: key %#llx hit %llu then %llu times\n",
+           sets, ways, lineSize, policy, key, first, second);
+    return 1;
+}
+
+/**********************************************************************/
+/* Name:        checkReuseTime                                        */
+/*                                                                    */
+/* Description: This function will check the reuse times and the      */
+/*              stack distances of the lines 0, 0, 1, 0: an immediate */
+/*              reuse has no access in between and no other line, the */
+/*              last one a single access and a single line            */
+/*                                                                    */
+/* Inputs:      NONE                                                  */
+/*                                                                    */
+/* Outputs:     0 if the bins are right, 1 otherwise                  */
+/**********************************************************************/
+int checkReuseTime(void){
+
+    const unsigned int lines[] = { 0, 0, 1, 0 };
+    struct stackDistance stack;
+    int failed = 0;
+
+    if(stackInit(&stack, 0) != 0){
+        printf("FAIL reuse time: out of memory\n");
+        return 1;
+    }
+    for(size_t i = 0; i < sizeof(lines) / sizeof(lines[0]); i++)
+        failed |= stackAccess(&stack, lines[i]) != 0;
+    failed |= stack.timeHistogram[0] != 1 || stack.timeHistogram[1] != 1 ||
+              stack.histogram[0] != 1 || stack.histogram[1] != 1;
+    if(failed)
+        printf("FAIL reuse time: bins 0 and 1 hold %llu and %llu times, %llu and %llu "
+               "distances\n", stack.timeHistogram[0], stack.timeHistogram[1],
+               stack.histogram[0], stack.histogram[1]);
+    stackFree(&stack);
+    return failed;
+}
+
+/**********************************************************************/
+/* Name:        checkProfileReads                                     */
+/*                                                                    */
+/* Description: This function will profile the same reads through the */
+/*              kernel of a cache and through the engine, which must  */
+/*              count the same accesses and evictions in every set    */
+/*                                                                    */
+/* Inputs:      The policy of the cache                               */
+/*                                                                    */
+/* Outputs:     0 if the counts agree, 1 otherwise                    */
+/**********************************************************************/
+int checkProfileReads(int policy){
+
+    struct cacheConfig config = { 4, 2, 16, policy, WRITEBACK, WRITEALLOCATE };
+    struct cacheEngine caches[2];
+    struct profile profiles[2];
+    unsigned int addresses[1000];
+    int failed = 0;
+
+    for(size_t i = 0; i < sizeof(addresses) / sizeof(addresses[0]); i++)
+        addresses[i] = sampleHash((unsigned int)i) & 0x3ff;
+    for(int k = 0; k < 2; k++)
+        if(cacheInit(&caches[k], &config) != 0 ||
+           profileInit(&profiles[k], &caches[k], 100, 1.0) != 0){
+            printf("FAIL profile reads: cannot create\n");
+            return 1;
+        }
+    profileReads(&profiles[0], &caches[0], kernelSelect(&caches[0]), addresses,
+                 sizeof(addresses) / sizeof(addresses[0]));
+    for(size_t i = 0; i < sizeof(addresses) / sizeof(addresses[0]); i++)
+        profileReference(&profiles[1], &caches[1], addresses[i], READ, 0);
+    for(unsigned int set = 0; set < config.sets; set++)
+        if(profiles[0].setAccesses[set] != profiles[1].setAccesses[set] ||
+           profiles[0].setEvictions[set] != profiles[1].setEvictions[set]){
+            printf("FAIL profile reads, policy %d: set %u has %llu accesses and %llu evictions "
+                   "instead of %llu and %llu\n", policy, set, profiles[0].setAccesses[set],
+                   profiles[0].setEvictions[set], profiles[1].setAccesses[set],
+                   profiles[1].setEvictions[set]);
+            failed = 1;
+        }
+    for(int k = 0; k < 2; k++){
+        profileFree(&profiles[k]);
+        cacheFree(&caches[k]);
+    }
+    return failed;
+}
+
+/**********************************************************************/
+/* Name:        checkClassifyReads                                    */
+/*                                                                    */
+/* Description: This function will classify the misses of the same    */
+/*              reads through the kernel of a cache and through the   */
+/*              engine, which must agree on every kind and on the     */
+/*              regions                                               */
+/*                                                                    */
+/* Inputs:      The policy of the cache                               */
+/*                                                                    */
+/* Outputs:     0 if the counts agree, 1 otherwise                    */
+/**********************************************************************/
+int checkClassifyReads(int policy){
+
+    struct cacheConfig config = { 4, 2, 16, policy, WRITEBACK, WRITEALLOCATE };
+    struct cacheEngine caches[2];
+    struct classifier classifiers[2];
+    unsigned int addresses[1000];
+    int failed = 0;
+
+    for(size_t i = 0; i < sizeof(addresses) / sizeof(addresses[0]); i++)
+        addresses[i] = sampleHash((unsigned int)i) & 0x3ff;
+    for(int k = 0; k < 2; k++)
+        if(cacheInit(&caches[k], &config) != 0 || classifierInit(&classifiers[k], &config, 8) != 0){
+            printf("FAIL classify reads: cannot create\n");
+            return 1;
+        }
+    classifierReads(&classifiers[0], &caches[0], kernelSelect(&caches[0]), addresses,
+                    sizeof(addresses) / sizeof(addresses[0]));
+    for(size_t i = 0; i < sizeof(addresses) / sizeof(addresses[0]); i++)
+        classifierReference(&classifiers[1], &caches[1], addresses[i], READ, 0);
+    failed |= memcmp(classifiers[0].misses, classifiers[1].misses,
+                     sizeof(classifiers[0].misses)) != 0;
+    failed |= classifiers[0].regionCount != classifiers[1].regionCount;
+    for(size_t r = 0; !failed && r < classifiers[0].regionCount; r++)
+        failed |= classifiers[0].regions[r].accesses != classifiers[1].regions[r].accesses ||
+                  memcmp(classifiers[0].regions[r].misses, classifiers[1].regions[r].misses,
+                         sizeof(classifiers[0].regions[r].misses)) != 0;
+    if(failed)
+        printf("FAIL classify reads, policy %d: %llu, %llu and %llu misses instead of %llu, %llu "
+               "and %llu\n", policy, classifiers[0].misses[0], classifiers[0].misses[1],
+               classifiers[0].misses[2], classifiers[1].misses[0], classifiers[1].misses[1],
+               classifiers[1].misses[2]);
+    for(int k = 0; k < 2; k++){
+        classifierFree(&classifiers[k]);
+        cacheFree(&caches[k]);
+    }
+    return failed;
+}
+
+/**********************************************************************/
+/* Name:        checkLatePrefetch                                     */
+/*                                                                    */
+/* Description: This function will prefetch eight lines after a miss  */
+/*              and use the first of them at once, which is late even */
+/*              though the fills of the others moved the timer past   */
+/*              the latency, and the second after a few hits, which   */
+/*              is in time                                            */
+/*                                                                    */
+/* Inputs:      NONE                                                  */
+/*                                                                    */
+/* Outputs:     0 if only the first use is late, 1 otherwise          */
+/**********************************************************************/
+int checkLatePrefetch(void){
+
+    struct cacheConfig config = { 16, 4, 16, LRU, WRITEBACK, WRITEALLOCATE };
+    struct cacheEngine cache;
+    struct prefetcher prefetcher;
+    int failed = 0;
+
+    if(cacheInit(&cache, &config) != 0 ||
+       prefetcherInit(&prefetcher, &cache, NEXTLINE, 8, 4) != 0){
+        printf("FAIL late prefetch: cannot create\n");
+        return 1;
+    }
+    prefetchReference(&prefetcher, &cache, 0x000, READ, 0);
+    prefetchReference(&prefetcher, &cache, 0x010, READ, 0);
+    for(int i = 0; i < 4; i++)
+        prefetchReference(&prefetcher, &cache, 0x000, READ, 0);
+    prefetchReference(&prefetcher, &cache, 0x020, READ, 0);
+    if(cache.prefetchHits != 2 || cache.prefetchLate != 1){
+        printf("FAIL late prefetch: %llu prefetches used and %llu late instead of 2 and 1\n",
+               cache.prefetchHits, cache.prefetchLate);
+        failed = 1;
+    }
+    cacheFree(&cache);
+    return failed;
+}
+
+/**********************************************************************/
+/* Name:        checkCorruptCheckpoint                                */
+/*                                                                    */
+/* Description: This function will save a cache, overwrite four bytes  */
+/*              of its checkpoint with 0xfe, which is neither a state */
+/*              nor an index nor NOENTRY, and load it again, which    */
+/*              must fail rather than leave an index out of range     */
+/*                                                                    */
+/* Inputs:      The configuration of the cache; the offset of the     */
+/*              bytes in the checkpoint, 0 to leave it as it is       */
+/*                                                                    */
+/* Outputs:     0 if the load fails exactly when the checkpoint was   */
+/*              overwritten, 1 otherwise                              */
+/**********************************************************************/
+int checkCorruptCheckpoint(struct cacheConfig config, long offset){
+
+    const char *name = "CacheTest.ckp";
+    const unsigned char bad[4] = { 0xfe, 0xfe, 0xfe, 0xfe };
+    struct cacheEngine cache;
+    struct traceMark mark = { 0 };
+    unsigned long long accesses;
+    FILE *fp;
+    int status;
+
+    if(cacheInit(&cache, &config) != 0){
+        printf("FAIL checkpoint: cannot create\n");
+        return 1;
+    }
+    for(unsigned int i = 0; i < 4 * config.sets * config.ways; i++)
+        cacheReference(&cache, (unsigned long long)sampleHash(i) * config.lineSize, READ, 0);
+    status = checkpointSave(name, &cache, &mark, 0);
+    cacheFree(&cache);
+    if(status == 0 && offset != 0 && ((fp = fopen(name, "r+b")) == NULL ||
+                                      fseek(fp, offset, SEEK_SET) != 0 ||
+                                      fwrite(bad, 1, sizeof(bad), fp) != sizeof(bad) ||
+                                      fclose(fp) != 0))
+        status = -1;
+    if(status != 0){
+        printf("FAIL checkpoint: cannot write %s\n", name);
+        remove(name);
+        return 1;
+    }
+
+    status = checkpointLoad(name, &cache, &config, &mark, &accesses);
+    remove(name);
+    if(status == 0)
+        cacheFree(&cache);
+    if((status == 0) == (offset == 0))
+        return 0;
+    printf("FAIL checkpoint of %u sets, %u ways, %s with bytes %ld overwritten: load gave %d\n",
+           config.sets, config.ways, policyNames[config.policy], offset, status);
+    return 1;
+}
+
+/**********************************************************************/
+/* Name:        checkTextTrace                                        */
+/*                                                                    */
+/* Description: This function will parse a text trace and compare its  */
+/*              accesses and whether it failed with the expected ones */
+/*                                                                    */
+/* Inputs:      The text; the expected addresses, types and sizes;    */
+/*              their number; 1 if the trace must fail                */
+/*                                                                    */
+/* Outputs:     0 if the trace parses as expected, 1 otherwise        */
+/**********************************************************************/
+int checkTextTrace(const char *text, const unsigned int addresses[], const unsigned char types[],
+                   const unsigned char sizes[], size_t count, int failing){
+
+    const char *name = "CacheTest.txt";
+    unsigned int read[8];
+    unsigned char readTypes[8], readSizes[8];
+    struct trace trace;
+    size_t n = 0, got;
+    FILE *fp = fopen(name, "w");
+    int failed = 0;
+
+    if(fp == NULL || fputs(text, fp) == EOF || fclose(fp) != 0 || traceOpen(&trace, name) != 0){
+        printf("FAIL text trace: cannot write %s\n", name);
+        remove(name);
+        return 1;
+    }
+    while(n < 8 && (got = traceReadAccesses(&trace, read + n, readTypes + n, readSizes + n,
+                                            8 - n)) > 0)
+        n += got;
+    failed |= n != count || (traceClose(&trace) != 0) != failing;
+    for(size_t i = 0; !failed && i < count; i++)
+        failed |= read[i] != addresses[i] || readTypes[i] != types[i] || readSizes[i] != sizes[i];
+    remove(name);
+    if(failed)
+        printf("FAIL text trace \"%s\": %zu accesses, %s\n", text, n,
+               failing ? "expected to fail" : "expected to parse");
+    return failed;
+}
+
+/**********************************************************************/
+/* Name:        threadSeconds                                         */
+/*                                                                    */
+/* Description: This function will return the processor time of the   */
+/*              calling thread                                        */
+/*                                                                    */
+/* Inputs:      NONE                                                  */
+/*                                                                    */
+/* Outputs:     The time in seconds                                   */
+/**********************************************************************/
+double threadSeconds(void){
+    struct timespec now;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+    return now.tv_sec + now.tv_nsec/1e9;
+}
+
+/**********************************************************************/
+/* Name:        checkIdleRing                                         */
+/*                                                                    */
+/* Description: This function will read a pipe through a ring and wait */
+/*              for more while nothing is written to it: the consumer */
+/*              must sleep rather than poll, give up at its deadline  */
+/*              and still get the end of the trace once the pipe is   */
+/*              closed                                                */
+/*                                                                    */
+/* Inputs:      NONE                                                  */
+/*                                                                    */
+/* Outputs:     0 if the consumer slept, 1 otherwise                  */
+/**********************************************************************/
+int checkIdleRing(void){
+
+    const char lines[] = "10\n20\n30\n40\n50\n60\n70\n80\n";
+    const double idle = 0.3;
+    struct trace trace;
+    struct traceRing ring;
+    const struct ringBlock *block;
+    char name[32];
+    int fds[2], failed = 0;
+    double start, busy;
+
+    if(pipe(fds) != 0 || write(fds[1], lines, sizeof(lines) - 1) != sizeof(lines) - 1){
+        printf("FAIL idle ring: cannot write a pipe\n");
+        return 1;
+    }
+    snprintf(name, sizeof(name), "/dev/fd/%d", fds[0]);
+    if(traceOpen(&trace, name) != 0 || ringOpen(&ring, &trace) != 0){
+        printf("FAIL idle ring: cannot read the pipe\n");
+        return 1;
+    }
+
+    start = wallClock();
+    busy = threadSeconds();
+    while((block = ringNext(&ring, start + idle)) != NULL){
+        failed |= block->count == 0;
+        ringRelease(&ring);
+    }
+    busy = threadSeconds() - busy;
+    failed |= wallClock() - start < idle || busy > idle / 10;
+
+    close(fds[1]);
+    while((block = ringNext(&ring, 0.0))->count > 0)
+        ringRelease(&ring);
+    ringRelease(&ring);
+    ringClose(&ring);
+    traceClose(&trace);
+    close(fds[0]);
+    if(failed)
+        printf("FAIL idle ring: the consumer used %.3f of %.3f seconds\n", busy, idle);
+    return failed;
+}
+
+int main(void){
+
+    const char *policies[] = { "fifo", "lru", "plru", "rrip", "random" };
+    const unsigned long long keys[] = { 0xffffffffffffffffull, 0, 0xffffffff };
+    const unsigned int ways[] = { 1, 2, 4, 8, 16, 64 };
+    const unsigned int lineSizes[] = { 1, 64 };
+    int failures = 0, checks = 0;
+
+    /* Every tag compare: scalar, vector, and the hash index of 64 ways */
+    for(size_t p = 0; p < sizeof(policies) / sizeof(policies[0]); p++)
+        for(size_t w = 0; w < sizeof(ways) / sizeof(ways[0]); w++)
+            for(size_t l = 0; l < sizeof(lineSizes) / sizeof(lineSizes[0]); l++)
+                for(size_t k = 0; k < sizeof(keys) / sizeof(keys[0]); k++){
+                    unsigned int sets = ways[w] == 64 ? 1 : 4;
+                    failures += checkColdKey(sets, ways[w], lineSizes[l], policies[p], keys[k]);
+                    checks++;
+                }
+
+    failures += checkReuseTime();
+    checks++;
+    failures += checkProfileReads(FIFO);
+    failures += checkProfileReads(LRU);
+    checks += 2;
+    failures += checkClassifyReads(FIFO);
+    failures += checkClassifyReads(LRU);
+    checks += 2;
+    failures += checkLatePrefetch();
+    checks++;
+    failures += checkIdleRing();
+    checks++;
+
+    /* A size follows a colon, any other number is an address; an address
+    of more than 8 digits that does not fit fails the trace, through the
+    vector parser with 16 bytes left and the scalar one near the end */
+    {
+        const unsigned int addresses[] = { 0x10, 0x20, 0x8, 0x300 };
+        const unsigned char types[] = { WRITE, READ, READ, READ };
+        const unsigned char sizes[] = { 4, 0, 0, 255 };
+
+        failures += checkTextTrace("W 10:4 20 8\n000000000300 : 1000\n", addresses, types, sizes,
+                                   4, 0);
+        failures += checkTextTrace("W 10:4\n123456789 and more text\n", addresses, types, sizes,
+                                   1, 1);
+        failures += checkTextTrace("W 10:4\n100000000", addresses, types, sizes, 1, 1);
+        checks += 3;
+    }
+
+    /* A checkpoint is its magic, the words, the entries and the arrays:
+    the victims, the filled counts, the metadata and then the hash index,
+    the spare stack and the lists of the hashed caches */
+    {
+        struct cacheConfig small = { 4, 2, 64, FIFO, WRITEBACK, WRITEALLOCATE };
+        struct cacheConfig hashed = { 1, 64, 64, LRU, WRITEBACK, WRITEALLOCATE };
+        long words = 4, entries = words + CHECKPOINTWORDS * 8;
+        long victims = entries + 8 * ENTRYBYTES, filled = victims + 4 * 4;
+        long bucket = entries + 64 * ENTRYBYTES + 4 + 4 + 64;
+        long spare = bucket + 128 * 4, newer = spare + 64 * 4, older = newer + 64 * 4;
+        const long smallOffsets[] = { 0, entries + 16, victims, filled + 4 };
+        const long hashedOffsets[] = { 0, words + 11 * 8, words + 12 * 8, words + 10 * 8, bucket,
+                                       bucket + 60, newer + 8, older + 8 };
+
+        for(size_t i = 0; i < sizeof(smallOffsets) / sizeof(smallOffsets[0]); i++)
+            failures += checkCorruptCheckpoint(small, smallOffsets[i]);
+        for(size_t i = 0; i < sizeof(hashedOffsets) / sizeof(hashedOffsets[0]); i++)
+            failures += checkCorruptCheckpoint(hashed, hashedOffsets[i]);
+        checks += (int)(sizeof(smallOffsets) / sizeof(smallOffsets[0]) +
+                        sizeof(hashedOffsets) / sizeof(hashedOffsets[0]));
+    }
+
+    printf("%d of %d checks passed\n", checks - failures, checks);
+    return failures != 0;
+}
@@ -0,0 +1,274 @@
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "CacheEngine.h"
+#include "Trace.h"
+
+/* A checkpoint starts with CHECKPOINTMAGIC and CHECKPOINTWORDS numbers of
+64 bits: the configuration, the counters and the scalar state of the cache,
+and where the trace was. The entries follow packed in ENTRYBYTES bytes,
+then the arrays of the cache that exist for its configuration. Numbers are
+in the byte order of the machine that wrote the checkpoint. CKP1 had 32 bit
+counters and timers, and is not read */
+#define CHECKPOINTMAGIC "CKP2"
+#define CHECKPOINTWORDS 24
+#define ENTRYBYTES      17
+#define CHECKPOINTCHUNK 4096
+
+/**********************************************************************/
+/* Name:        checkpointArrays                                      */
+/*                                                                    */
+/* Description: This function will read or write the arrays of the    */
+/*              replacement policies and of the hash index            */
+/*                                                                    */
+/* Inputs:      The cache; the file; 1 to write, 0 to read            */
+/*                                                                    */
+/* Outputs:     0 on success, -1 on a read or write error             */
+/**********************************************************************/
+int checkpointArrays(struct cacheEngine *cache, FILE *fp, int writing){
+
+    size_t size = (size_t)cache->sets * cache->ways;
+    int lists = cache->newer != NULL && cache->policy == RRIP;
+    struct{
+        void   *data;
+        size_t bytes;
+    } arrays[] = {
+        { cache->victim, cache->sets * sizeof(unsigned int) },
+        { cache->filled, cache->sets * sizeof(unsigned int) },
+        { cache->metadata, size },
+        { cache->bucket, cache->bucket ? (cache->hashMask + 1ul) * sizeof(unsigned int) : 0 },
+        { cache->spare, cache->spare ? size * sizeof(unsigned int) : 0 },
+        { cache->newer, cache->newer ? size * sizeof(unsigned int) : 0 },
+        { cache->older, cache->older ? size * sizeof(unsigned int) : 0 },
+        { cache->newest, lists ? sizeof(cache->newest) : 0 },
+        { cache->oldest, lists ? sizeof(cache->oldest) : 0 },
+        { &cache->rrpvAge, lists ? sizeof(cache->rrpvAge) : 0 },
+    };
+
+    for(size_t i = 0; i < sizeof(arrays) / sizeof(arrays[0]); i++){
+        size_t done = writing ? fwrite(arrays[i].data, 1, arrays[i].bytes, fp)
+                              : fread(arrays[i].data, 1, arrays[i].bytes, fp);
+        if(done != arrays[i].bytes)
+            return -1;
+    }
+    return 0;
+}
+
+/**********************************************************************/
+/* Name:        checkpointValid                                       */
+/*                                                                    */
+/* Description: This function will check that the state read from a   */
+/*              checkpoint only holds indexes the engine can follow:  */
+/*              states, ways of the sets, entries of the lists, the   */
+/*              spare stack and the hash index, and metadata the      */
+/*              policy can use                                        */
+/*                                                                    */
+/* Inputs:      The cache                                             */
+/*                                                                    */
+/* Outputs:     1 if the state is consistent, 0 otherwise             */
+/**********************************************************************/
+int checkpointValid(const struct cacheEngine *cache){
+
+    size_t size = (size_t)cache->sets * cache->ways;
+    unsigned int lists = cache->policy == RRIP ? RRPVMAX + 1 : 1;
+
+    /* A fill scans a set for an invalid way while it is not full */
+    for(size_t i = 0; i < size; i++)
+        if(cache->states[i] != VALID && cache->states[i] != INVALID)
+            return 0;
+    for(unsigned int set = 0; set < cache->sets; set++){
+        unsigned int valid = 0;
+        for(unsigned int j = 0; j < cache->ways; j++)
+            valid += cache->states[(size_t)set * cache->ways + j] == VALID;
+        if(cache->victim[set] >= cache->ways || cache->filled[set] != valid)
+            return 0;
+    }
+    for(size_t i = 0; i < size; i++)
+        if((cache->policy == PLRU && cache->metadata[i] > 1) ||
+           (cache->policy == RRIP && cache->metadata[i] > RRPVMAX))
+            return 0;
+
+    /* The spare stack holds the invalid entries, the hash index the valid ones */
+    if(cache->spare != NULL){
+        if(cache->spareCount != cache->ways - cache->filled[0])
+            return 0;
+        for(unsigned int k = 0; k < cache->spareCount; k++)
+            if(cache->spare[k] >= size || cache->states[cache->spare[k]] != INVALID)
+                return 0;
+    }
+    if(cache->bucket != NULL){
+        unsigned int used = 0;
+        for(size_t i = 0; i <= cache->hashMask; i++){
+            if(cache->bucket[i] == NOENTRY)
+                continue;
+            if(cache->bucket[i] >= size || cache->states[cache->bucket[i]] != VALID)
+                return 0;
+            used++;
+        }
+        if(used != cache->filled[0])
+            return 0;
+    }
+    if(cache->newer != NULL){
+        if(cache->rrpvAge > RRPVMAX)
+            return 0;
+        for(unsigned int list = 0; list < lists; list++)
+            if((cache->newest[list] != NOENTRY && cache->newest[list] >= size) ||
+               (cache->oldest[list] != NOENTRY && cache->oldest[list] >= size))
+                return 0;
+        for(size_t i = 0; i < size; i++)
+            if((cache->newer[i] != NOENTRY && cache->newer[i] >= size) ||
+               (cache->older[i] != NOENTRY && cache->older[i] >= size))
+                return 0;
+    }
+    return 1;
+}
+
+/**********************************************************************/
+/* Name:        checkpointSave                                        */
+/*                                                                    */
+/* Description: This function will write the whole state of a cache   */
+/*              and the position of its trace, so a later run can     */
+/*              continue from it instead of warming the cache again   */
+/*                                                                    */
+/* Inputs:      The name of the checkpoint; the cache; a mark of the  */
+/*              trace; the addresses simulated, at or after the mark  */
+/*                                                                    */
+/* Outputs:     0 on success, -1 on a write error                     */
+/**********************************************************************/
+int checkpointSave(const char *name, struct cacheEngine *cache, const struct traceMark *mark,
+                   unsigned long long accesses){
+
+    unsigned long long words[CHECKPOINTWORDS] = {
+        cache->sets, cache->ways, cache->lineSize, (unsigned long long)cache->policy,
+        (unsigned long long)cache->writePolicy, (unsigned long long)cache->allocate,
+        cache->hits, cache->events, cache->timer, cache->seed, cache->spareCount,
+        cache->newest[0], cache->oldest[0], cache->writes, cache->writeHits, cache->writebacks,
+        cache->fillBytes, cache->writebackBytes, cache->writeThroughBytes,
+        mark->accesses, mark->offset, mark->blockLeft, mark->previous, accesses
+    };
+    unsigned char buffer[CHECKPOINTCHUNK * ENTRYBYTES];
+    size_t size = (size_t)cache->sets * cache->ways;
+    FILE *fp = fopen(name, "wb");
+    int status = 0;
+
+    if(fp == NULL)
+        return -1;
+    if(fwrite(CHECKPOINTMAGIC, 1, 4, fp) != 4 ||
+       fwrite(words, sizeof(words[0]), CHECKPOINTWORDS, fp) != CHECKPOINTWORDS)
+        status = -1;
+
+    /* The entries are packed without the padding of the structure */
+    for(size_t first = 0; first < size && status == 0; first += CHECKPOINTCHUNK){
+        size_t count = size - first < CHECKPOINTCHUNK ? size - first : CHECKPOINTCHUNK;
+        for(size_t i = 0; i < count; i++){
+            const struct cache *entry = &cache->entries[first + i];
+            unsigned char *p = buffer + i * ENTRYBYTES;
+            memcpy(p, &entry->address, 8);
+            memcpy(p + 8, &cache->timers[first + i], 8);
+            p[16] = (unsigned char)(cache->states[first + i] | entry->dirty << 2 |
+                                    entry->coherence << 3 | entry->prefetched << 6);
+        }
+        if(fwrite(buffer, ENTRYBYTES, count, fp) != count)
+            status = -1;
+    }
+    if(status == 0)
+        status = checkpointArrays(cache, fp, 1);
+    if(fclose(fp) != 0)
+        status = -1;
+    return status;
+}
+
+/**********************************************************************/
+/* Name:        checkpointLoad                                        */
+/*                                                                    */
+/* Description: This function will allocate a cache with the state    */
+/*              saved in a checkpoint                                 */
+/*                                                                    */
+/* Inputs:      The name of the checkpoint; the cache; the            */
+/*              configuration it must have; the mark of the trace and */
+/*              the addresses simulated, as saved                     */
+/*                                                                    */
+/* Outputs:     0 on success, -1 if the checkpoint cannot be read or  */
+/*              holds indexes out of range, -2 if it holds a cache of */
+/*              another configuration                                 */
+/**********************************************************************/
+int checkpointLoad(const char *name, struct cacheEngine *cache, const struct cacheConfig *config,
+                   struct traceMark *mark, unsigned long long *accesses){
+
+    unsigned long long words[CHECKPOINTWORDS];
+    unsigned char buffer[CHECKPOINTCHUNK * ENTRYBYTES];
+    char magic[4];
+    size_t size;
+    FILE *fp = fopen(name, "rb");
+
+    if(fp == NULL)
+        return -1;
+    if(fread(magic, 1, 4, fp) != 4 || memcmp(magic, CHECKPOINTMAGIC, 4) != 0 ||
+       fread(words, sizeof(words[0]), CHECKPOINTWORDS, fp) != CHECKPOINTWORDS){
+        fclose(fp);
+        return -1;
+    }
+    if(words[0] != config->sets || words[1] != config->ways || words[2] != config->lineSize ||
+       words[3] != (unsigned long long)config->policy ||
+       words[4] != (unsigned long long)config->writePolicy ||
+       words[5] != (unsigned long long)config->allocate){
+        fclose(fp);
+        return -2;
+    }
+    if(cacheInit(cache, config) != 0){
+        fclose(fp);
+        return -1;
+    }
+
+    cache->hits = words[6];
+    cache->events = words[7];
+    cache->timer = words[8];
+    cache->seed = (unsigned int)words[9];
+    cache->spareCount = (unsigned int)words[10];
+    cache->newest[0] = (unsigned int)words[11];
+    cache->oldest[0] = (unsigned int)words[12];
+    cache->writes = words[13];
+    cache->writeHits = words[14];
+    cache->writebacks = words[15];
+    cache->fillBytes = words[16];
+    cache->writebackBytes = words[17];
+    cache->writeThroughBytes = words[18];
+    mark->accesses = words[19];
+    mark->offset = words[20];
+    mark->blockLeft = (unsigned int)words[21];
+    mark->previous = (unsigned int)words[22];
+    *accesses = words[23];
+
+    size = (size_t)cache->sets * cache->ways;
+    for(size_t first = 0; first < size; first += CHECKPOINTCHUNK){
+        size_t count = size - first < CHECKPOINTCHUNK ? size - first : CHECKPOINTCHUNK;
+        if(fread(buffer, ENTRYBYTES, count, fp) != count)
+            goto failed;
+        for(size_t i = 0; i < count; i++){
+            struct cache *entry = &cache->entries[first + i];
+            const unsigned char *p = buffer + i * ENTRYBYTES;
+            memcpy(&entry->address, p, 8);
+            memcpy(&cache->timers[first + i], p + 8, 8);
+            cache->states[first + i] = p[16] & 3;
+            entry->dirty = (char)(p[16] >> 2 & 1);
+            entry->coherence = (char)(p[16] >> 3 & 7);
+            entry->prefetched = (char)(p[16] >> 6 & 1);
+            cache->tags[first + i] = entry->address;
+        }
+    }
+    if(checkpointArrays(cache, fp, 0) != 0 || !checkpointValid(cache))
+        goto failed;
+    fclose(fp);
+    return 0;
+
+failed:
+    fclose(fp);
+    cacheFree(cache);
+    return -1;
+}
+
+#endif
@@ -0,0 +1,599 @@
+#ifndef CLASSIFICATION_H
+#define CLASSIFICATION_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "CacheEngine.h"
+#include "Kernels.h"
+
+/* Initial buckets of a line table and length of a region name */
+#define TABLEBUCKETS 4096
+#define REGIONNAME   64
+
+/* Accesses ahead of the current one whose bucket of the line table a batch
+of reads prefetches */
+#define CLASSIFYAHEAD 8
+
+/* The three kinds of miss: the first access to a line, a miss that a fully
+associative LRU cache of the same capacity would also have, and a miss that
+only the placement of the cache causes */
+enum missKind { COMPULSORY = 0, CAPACITY, CONFLICT };
+
+const char *missKindNames[] = { "compulsory", "capacity", "conflict" };
+
+/* Open addressing table from 64 bit keys to indexes, kept at most half
+full; a key and its value share a bucket so a probe touches one line */
+struct tableBucket{
+    unsigned long long key;
+    unsigned int       value;       /* NOENTRY marks an empty bucket */
+};
+
+struct lineTable{
+    struct tableBucket *bucket;
+    size_t             buckets;     /* A power of two */
+    size_t             count;
+};
+
+/* Accesses and misses of an address range: a symbol of the map file or
+one of the fixed size regions */
+struct region{
+    unsigned long long start;
+    unsigned long long end;         /* One past the last address */
+    char               name[REGIONNAME];
+    unsigned long long accesses;
+    unsigned long long misses[CONFLICT + 1];
+};
+
+/* The seen set and the shadow fully associative LRU cache share a single
+table of every line accessed so far, whose value is the last slot of the
+line in the shadow cache; the line is still there if the slot holds it. One
+probe tells both whether the line was seen and whether the shadow holds it,
+and an eviction does not touch the table, which never deletes. The slots
+form an LRU list */
+struct classifier{
+    struct lineTable   lines;
+    unsigned long long *lineOf;     /* Line held by every slot */
+    unsigned int       *newer;      /* Next slot towards the most recent */
+    unsigned int       *older;      /* Next slot towards the least recent */
+    unsigned int       newest;
+    unsigned int       oldest;
+    unsigned int       used;        /* Slots filled so far */
+    unsigned int       capacity;    /* Lines of the cache */
+    unsigned long long misses[CONFLICT + 1];
+
+    /* Attribution of the misses to ranges, sorted by their start, or to
+    regions of 2^regionBits bytes found through a line table */
+    struct region      *regions;
+    size_t             regionCount;
+    size_t             regionCapacity;
+    int                mapped;      /* 1 if the ranges come from a map file */
+    unsigned int       regionBits;  /* 0 for no attribution */
+    struct lineTable   regionIndex;
+    unsigned long long lastNumber;  /* Region found last, which the next */
+    unsigned int       lastRegion;  /* access most likely shares; NOENTRY */
+};
+
+/**********************************************************************/
+/* Name:        tableInit                                             */
+/*                                                                    */
+/* Description: This function will allocate an empty line table        */
+/*                                                                    */
+/* Inputs:      The table; the number of buckets, a power of two      */
+/*                                                                    */
+/* Outputs:     0 on success, -1 if there is no memory                */
+/**********************************************************************/
+int tableInit(struct lineTable *table, size_t buckets){
+
+    table->buckets = buckets;
+    table->count = 0;
+    table->bucket = malloc(buckets * sizeof(struct tableBucket));
+    if(table->bucket == NULL)
+        return -1;
+    for(size_t i = 0; i < buckets; i++)
+        table->bucket[i].value = NOENTRY;
+    return 0;
+}
+
+/**********************************************************************/
+/* Name:        tableBucket                                           */
+/*                                                                    */
+/* Description: This function will find the bucket of a key, or the    */
+/*              empty bucket where it would go                        */
+/*                                                                    */
+/* Inputs:      The table; the key                                    */
+/*                                                                    */
+/* Outputs:     The bucket                                            */
+/**********************************************************************/
+size_t tableBucket(struct lineTable *table, unsigned long long key){
+
+    size_t mask = table->buckets - 1;
+    unsigned long long hash = key * 0x9e3779b97f4a7c15ull;
+    size_t i = (size_t)(hash ^ (hash >> 32)) & mask;
+
+    while(table->bucket[i].value != NOENTRY && table->bucket[i].key != key)
+        i = (i + 1) & mask;
+    return i;
+}
+
+/**********************************************************************/
+/* Name:        tablePrefetch                                         */
+/*                                                                    */
+/* Description: This function will start loading the home bucket of a  */
+/*              key, so that a later probe finds it in the cache      */
+/*                                                                    */
+/* Inputs:      The table; the key                                    */
+/*                                                                    */
+/* Outputs:     NONE                                                  */
+/**********************************************************************/
+void tablePrefetch(const struct lineTable *table, unsigned long long key){
+#ifdef __GNUC__
+    unsigned long long hash = key * 0x9e3779b97f4a7c15ull;
+    __builtin_prefetch(&table->bucket[(size_t)(hash ^ (hash >> 32)) & (table->buckets - 1)]);
+#else
+    (void)table;
+    (void)key;
+#endif
+}
+
+/**********************************************************************/
+/* Name:        tableGrow                                             */
+/*                                                                    */
+/* Description: This function will double the buckets of a line table */
+/*                                                                    */
+/* Inputs:      The table                                             */
+/*                                                                    */
+/* Outputs:     0 on success, -1 if there is no memory                */
+/**********************************************************************/
+int tableGrow(struct lineTable *table){
+
+    struct lineTable grown;
+
+    if(tableInit(&grown, 2 * table->buckets) != 0)
+        return -1;
+    for(size_t j = 0; j < table->buckets; j++)
+        if(table->bucket[j].value != NOENTRY)
+            grown.bucket[tableBucket(&grown, table->bucket[j].key)] = table->bucket[j];
+    grown.count = table->count;
+    free(table->bucket);
+    *table = grown;
+    return 0;
+}
+
+/**********************************************************************/
+/* Name:        tableInsert                                           */
+/*                                                                    */
+/* Description: This function will look a key up and add it with a    */
+/*              value if it is absent, doubling the buckets when the  */
+/*              table gets half full                                  */
+/*                                                                    */
+/* Inputs:      The table; the key; the value for a new key           */
+/*                                                                    */
+/* Outputs:     The value of the key, NOENTRY if there is no memory   */
+/**********************************************************************/
+unsigned int tableInsert(struct lineTable *table, unsigned long long key, unsigned int value){
+
+    size_t i = tableBucket(table, key);
+
+    if(table->bucket[i].value != NOENTRY)
+        return table->bucket[i].value;
+    if(2 * (table->count + 1) > table->buckets){
+        if(tableGrow(table) != 0)
+            return NOENTRY;
+        i = tableBucket(table, key);
+    }
+
+    table->bucket[i].key = key;
+    table->bucket[i].value = value;
+    table->count++;
+    return value;
+}
+
+/**********************************************************************/
+/* Name:        compareRegions                                        */
+/*                                                                    */
+/* Description: This function will order two ranges by their start,    */
+/*              for qsort                                             */
+/*                                                                    */
+/* Inputs:      Two pointers to ranges                                */
+/*                                                                    */
+/* Outputs:     Negative, zero or positive                            */
+/**********************************************************************/
+int compareRegions(const void *a, const void *b){
+    const struct region *x = a, *y = b;
+    return (x->start > y->start) - (x->start < y->start);
+}
+
+/**********************************************************************/
+/* Name:        compareMisses                                         */
+/*                                                                    */
+/* Description: This function will order two regions by their misses,  */
+/*              the most first, for qsort                             */
+/*                                                                    */
+/* Inputs:      Two pointers to pointers to regions                   */
+/*                                                                    */
+/* Outputs:     Negative, zero or positive                            */
+/**********************************************************************/
+int compareMisses(const void *a, const void *b){
+    const struct region *x = *(struct region * const *)a, *y = *(struct region * const *)b;
+    unsigned long long m = x->misses[0] + x->misses[1] + x->misses[2];
+    unsigned long long n = y->misses[0] + y->misses[1] + y->misses[2];
+    return (m < n) - (m > n);
+}
+
+/**********************************************************************/
+/* Name:        addRegion                                             */
+/*                                                                    */
+/* Description: This function will append a range to the regions      */
+/*                                                                    */
+/* Inputs:      The classifier; the first address; one past the last; */
+/*              the name                                              */
+/*                                                                    */
+/* Outputs:     The region, NULL if there is no memory                */
+/**********************************************************************/
+struct region *addRegion(struct classifier *classifier, unsigned long long start,
+                         unsigned long long end, const char *name){
+
+    struct region *region;
+
+    if(classifier->regionCount == classifier->regionCapacity){
+        size_t capacity = classifier->regionCapacity ? 2 * classifier->regionCapacity : 256;
+        region = realloc(classifier->regions, capacity * sizeof(struct region));
+        if(region == NULL)
+            return NULL;
+        classifier->regions = region;
+        classifier->regionCapacity = capacity;
+    }
+    region = &classifier->regions[classifier->regionCount++];
+    memset(region, 0, sizeof(*region));
+    region->start = start;
+    region->end = end;
+    snprintf(region->name, REGIONNAME, "%s", name);
+    return region;
+}
+
+/**********************************************************************/
+/* Name:        loadRegions                                           */
+/*                                                                    */
+/* Description: This function will read the ranges of a map file: one  */
+/*              per line as a hexadecimal start, a hexadecimal end    */
+/*              one past the last address, and a name; lines that     */
+/*              start with a # are comments                           */
+/*                                                                    */
+/* Inputs:      The classifier; the name of the map file              */
+/*                                                                    */
+/* Outputs:     The number of ranges, -1 if the file cannot be read   */
+/**********************************************************************/
+int loadRegions(struct classifier *classifier, const char *name){
+
+    FILE *fp = fopen(name, "r");
+    char line[256], symbol[REGIONNAME];
+    unsigned long long start, end;
+
+    if(fp == NULL)
+        return -1;
+    while(fgets(line, sizeof(line), fp) != NULL){
+        if(line[0] == '#' || sscanf(line, "%llx %llx %63s", &start, &end, symbol) != 3)
+            continue;
+        if(end > start && addRegion(classifier, start, end, symbol) == NULL){
+            fclose(fp);
+            return -1;
+        }
+    }
+    fclose(fp);
+
+    qsort(classifier->regions, classifier->regionCount, sizeof(struct region), compareRegions);
+    classifier->mapped = 1;
+    return (int)classifier->regionCount;
+}
+
+/**********************************************************************/
+/* Name:        classifierInit                                        */
+/*                                                                    */
+/* Description: This function will prepare the classification of the   */
+/*              misses of a cache, with a shadow fully associative    */
+/*              LRU cache of the same number of lines                 */
+/*                                                                    */
+/* Inputs:      The classifier; the configuration of the cache; log2  */
+/*              of the size of the regions, 0 for none                */
+/*                                                                    */
+/* Outputs:     0 on success, -1 if there is no memory                */
+/**********************************************************************/
+int classifierInit(struct classifier *classifier, const struct cacheConfig *config,
+                   unsigned int regionBits){
+
+    size_t lines = (size_t)config->sets * config->ways;
+
+    memset(classifier, 0, sizeof(*classifier));
+    classifier->capacity = (unsigned int)lines;
+    classifier->newest = NOENTRY;
+    classifier->oldest = NOENTRY;
+    classifier->regionBits = regionBits;
+    classifier->lastRegion = NOENTRY;
+
+    classifier->lineOf = malloc(lines * sizeof(unsigned long long));
+    classifier->newer = malloc(lines * sizeof(unsigned int));
+    classifier->older = malloc(lines * sizeof(unsigned int));
+    if(classifier->lineOf == NULL || classifier->newer == NULL || classifier->older == NULL ||
+       tableInit(&classifier->lines, TABLEBUCKETS) != 0 ||
+       tableInit(&classifier->regionIndex, TABLEBUCKETS) != 0){
+        free(classifier->lineOf);
+        free(classifier->newer);
+        free(classifier->older);
+        free(classifier->lines.bucket);
+        return -1;
+    }
+    return 0;
+}
+
+/**********************************************************************/
+/* Name:        classifierFree                                        */
+/*                                                                    */
+/* Description: This function will release a classifier               */
+/*                                                                    */
+/* Inputs:      The classifier                                        */
+/*                                                                    */
+/* Outputs:     NONE                                                  */
+/**********************************************************************/
+void classifierFree(struct classifier *classifier){
+    free(classifier->lineOf);
+    free(classifier->newer);
+    free(classifier->older);
+    free(classifier->lines.bucket);
+    free(classifier->regionIndex.bucket);
+    free(classifier->regions);
+    memset(classifier, 0, sizeof(*classifier));
+}
+
+/**********************************************************************/
+/* Name:        shadowAccess                                          */
+/*                                                                    */
+/* Description: This function will access a line in the shadow cache   */
+/*              and tell whether it was seen before and whether the   */
+/*              shadow held it                                        */
+/*                                                                    */
+/* Inputs:      The classifier; the line                              */
+/*                                                                    */
+/* Outputs:     COMPULSORY for a new line, CAPACITY for a shadow     */
+/*              miss, CONFLICT for a shadow hit, -1 if there is no    */
+/*              memory                                                */
+/**********************************************************************/
+int shadowAccess(struct classifier *classifier, unsigned long long line){
+
+    struct lineTable *table = &classifier->lines;
+    size_t bucket = tableBucket(table, line);
+    unsigned int slot = table->bucket[bucket].value;
+    int kind;
+
+    if(slot != NOENTRY && classifier->lineOf[slot] == line){
+        /* Move the slot to the most recent end */
+        if(slot == classifier->newest)
+            return CONFLICT;
+        unsigned int newer = classifier->newer[slot];
+        unsigned int older = classifier->older[slot];
+        classifier->older[newer] = older;
+        if(older != NOENTRY)
+            classifier->newer[older] = newer;
+        else
+            classifier->oldest = newer;
+        kind = CONFLICT;
+    }
+    else{
+        if(slot == NOENTRY){
+            if(2 * (table->count + 1) > table->buckets){
+                if(tableGrow(table) != 0)
+                    return -1;
+                bucket = tableBucket(table, line);
+            }
+            table->bucket[bucket].key = line;
+            table->count++;
+            kind = COMPULSORY;
+        }
+        else
+            kind = CAPACITY;
+
+        /* Take a free slot or the least recent one */
+        if(classifier->used < classifier->capacity)
+            slot = classifier->used++;
+        else{
+            slot = classifier->oldest;
+            classifier->oldest = classifier->newer[slot];
+            if(classifier->oldest != NOENTRY)
+                classifier->older[classifier->oldest] = NOENTRY;
+            else
+                classifier->newest = NOENTRY;
+        }
+        table->bucket[bucket].value = slot;
+        classifier->lineOf[slot] = line;
+    }
+
+    classifier->newer[slot] = NOENTRY;
+    classifier->older[slot] = classifier->newest;
+    if(classifier->newest != NOENTRY)
+        classifier->newer[classifier->newest] = slot;
+    else
+        classifier->oldest = slot;
+    classifier->newest = slot;
+    return kind;
+}
+
+/**********************************************************************/
+/* Name:        findRegion                                            */
+/*                                                                    */
+/* Description: This function will find the range of the map file     */
+/*              that holds an address, by binary search, or the fixed */
+/*              size region of the address, creating it               */
+/*                                                                    */
+/* Inputs:      The classifier; an address                            */
+/*                                                                    */
+/* Outputs:     The region, NULL if there is none                     */
+/**********************************************************************/
+struct region *findRegion(struct classifier *classifier, unsigned long long address){
+
+    if(classifier->mapped){
+        size_t low = 0, high = classifier->regionCount;
+        while(low < high){
+            size_t middle = (low + high) / 2;
+            if(classifier->regions[middle].start <= address)
+                low = middle + 1;
+            else
+                high = middle;
+        }
+        if(low > 0 && address < classifier->regions[low - 1].end)
+            return &classifier->regions[low - 1];
+        return NULL;
+    }
+    if(classifier->regionBits == 0)
+        return NULL;
+
+    unsigned long long number = address >> classifier->regionBits;
+    if(classifier->lastRegion != NOENTRY && number == classifier->lastNumber)
+        return &classifier->regions[classifier->lastRegion];
+    unsigned int index = tableInsert(&classifier->regionIndex, number,
+                                     (unsigned int)classifier->regionCount);
+    if(index == NOENTRY)
+        return NULL;
+    if(index == classifier->regionCount){
+        char name[REGIONNAME];
+        snprintf(name, REGIONNAME, "%llx", number << classifier->regionBits);
+        if(addRegion(classifier, number << classifier->regionBits,
+                     (number + 1) << classifier->regionBits, name) == NULL)
+            return NULL;
+    }
+    classifier->lastNumber = number;
+    classifier->lastRegion = index;
+    return &classifier->regions[index];
+}
+
+/**********************************************************************/
+/* Name:        classifierReference                                   */
+/*                                                                    */
+/* Description: This function will simulate an access like            */
+/*              cacheReference and classify the miss of every line it */
+/*              touches                                               */
+/*                                                                    */
+/* Inputs:      The classifier; the cache; an address in decimal      */
+/*              format; the type of access; the number of bytes, 0    */
+/*              for one line                                          */
+/*                                                                    */
+/* Outputs:     NONE                                                  */
+/**********************************************************************/
+void classifierReference(struct classifier *classifier, struct cacheEngine *cache,
+                         unsigned long long address, int type, unsigned int size){
+
+    unsigned int offset = address & (cache->lineSize - 1);
+
+    if(size == 0)
+        size = ACCESSSIZE < cache->lineSize - offset ? ACCESSSIZE : cache->lineSize - offset;
+    for(;;){
+        unsigned int part = size;
+        if(offset + part > cache->lineSize)
+            part = cache->lineSize - offset;
+
+        int hit = cacheReferenceLine(cache, address, type, part);
+        int kind = shadowAccess(classifier, address >> cache->offsetBits);
+
+        struct region *region = findRegion(classifier, address);
+        if(region != NULL)
+            region->accesses++;
+        if(!hit && kind >= 0){
+            classifier->misses[kind]++;
+            if(region != NULL)
+                region->misses[kind]++;
+        }
+
+        if(part == size)
+            break;
+        address += part;
+        size -= part;
+        offset = 0;
+    }
+}
+
+/**********************************************************************/
+/* Name:        classifierReads                                       */
+/*                                                                    */
+/* Description: This function will simulate a batch of reads of       */
+/*              unknown size with the kernel of the cache and         */
+/*              classify their misses. Every read touches a single    */
+/*              line, which missed if the hits did not grow; the      */
+/*              buckets of the lines a few reads ahead are prefetched */
+/*              while the shadow handles the current one              */
+/*                                                                    */
+/* Inputs:      The classifier; the cache; its kernel; the addresses; */
+/*              their number                                          */
+/*                                                                    */
+/* Outputs:     NONE                                                  */
+/**********************************************************************/
+void classifierReads(struct classifier *classifier, struct cacheEngine *cache, cacheKernel kernel,
+                     const unsigned int addresses[], size_t count){
+    for(size_t i = 0; i < count; i++){
+        unsigned long long hits = cache->hits;
+
+        if(i + CLASSIFYAHEAD < count)
+            tablePrefetch(&classifier->lines, addresses[i + CLASSIFYAHEAD] >> cache->offsetBits);
+        kernel(cache, &addresses[i], 1);
+        int kind = shadowAccess(classifier, addresses[i] >> cache->offsetBits);
+
+        struct region *region = findRegion(classifier, addresses[i]);
+        if(region != NULL)
+            region->accesses++;
+        if(cache->hits == hits && kind >= 0){
+            classifier->misses[kind]++;
+            if(region != NULL)
+                region->misses[kind]++;
+        }
+    }
+}
+
+/**********************************************************************/
+/* Name:        classifierStatistics                                  */
+/*                                                                    */
+/* Description: This function will print the misses of every kind and  */
+/*              the regions with the most misses                      */
+/*                                                                    */
+/* Inputs:      The classifier; the number of regions to print        */
+/*                                                                    */
+/* Outputs:     NONE                                                  */
+/**********************************************************************/
+void classifierStatistics(struct classifier *classifier, size_t top){
+
+    unsigned long long total = classifier->misses[COMPULSORY] + classifier->misses[CAPACITY] +
+                               classifier->misses[CONFLICT];
+
+    printf("Misses: ");
+    for(int kind = COMPULSORY; kind <= CONFLICT; kind++)
+        printf("%llu %s (%.2f%%)%s", classifier->misses[kind], missKindNames[kind],
+               total ? 100.0 * classifier->misses[kind] / total : 0.0,
+               kind == CONFLICT ? "\n" : ", ");
+
+    if(classifier->regionCount == 0){
+        printf("\n");
+        return;
+    }
+
+    /* Sort pointers, so the regions keep their order for the lookups */
+    struct region **order = malloc(classifier->regionCount * sizeof(struct region *));
+    if(order == NULL)
+        return;
+    for(size_t i = 0; i < classifier->regionCount; i++)
+        order[i] = &classifier->regions[i];
+    qsort(order, classifier->regionCount, sizeof(struct region *), compareMisses);
+    if(top > classifier->regionCount)
+        top = classifier->regionCount;
+
+    printf("-------------------------------------------------------------------------------------------------\n");
+    printf("| REGION                 |   ACCESSES   |    MISSES    |  COMPULSORY |   CAPACITY  |  CONFLICT  |\n");
+    printf("-------------------------------------------------------------------------------------------------\n");
+    for(size_t i = 0; i < top; i++){
+        struct region *region = order[i];
+        printf("| %-22.22s | %12llu | %12llu | %11llu | %11llu | %10llu |\n", region->name,
+               region->accesses, region->misses[0] + region->misses[1] + region->misses[2],
+               region->misses[COMPULSORY], region->misses[CAPACITY], region->misses[CONFLICT]);
+    }
+    printf("-------------------------------------------------------------------------------------------------\n\n");
+    free(order);
+}
+
+#endif
@@ -0,0 +1,288 @@
+#ifndef COHERENCE_H
+#define COHERENCE_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "CacheEngine.h"
+#include "Trace.h"
+
+#define MAXCORES 64
+
+/* Snooping protocols; MOESI lets a modified line be shared without
+writing it back, by keeping the writer as its owner */
+enum protocol { MESI = 0, MOESI };
+
+const char *protocolNames[] = { "mesi", "moesi" };
+
+/* Coherence state of a line, kept in the coherence field of its entry */
+enum coherenceState { I_STATE = 0, S_STATE, E_STATE, O_STATE, M_STATE };
+
+/* A core and its private cache. For every entry the core keeps the words
+of the line it has used since the line was filled, so an invalidation
+caused by a write to a word the core never used is false sharing */
+struct core{
+    struct cacheEngine cache;
+    unsigned long long *touched;
+    unsigned long long accesses;
+    unsigned long long hits;
+    unsigned long long misses;
+    unsigned long long invalidations;   /* Lines taken away by other cores */
+    unsigned long long falseSharing;    /* Of those, by writes to unused words */
+};
+
+struct coherence{
+    struct core        cores[MAXCORES];
+    int                count;
+    int                protocol;
+    unsigned int       lineSize;
+    unsigned int       wordShift;       /* log2 of the bytes per tracked word */
+
+    /* Bus transactions and the data they moved */
+    unsigned long long busReads;
+    unsigned long long busReadsExclusive;
+    unsigned long long busUpgrades;
+    unsigned long long writebacks;
+    unsigned long long transfers;       /* Lines supplied by another cache */
+    unsigned long long memoryReads;     /* Lines supplied by memory */
+    unsigned long long busBytes;
+};
+
+/**********************************************************************/
+/* Name:        protocolName                                          */
+/*                                                                    */
+/* Description: This function will find the protocol with a given     */
+/*              name                                                  */
+/*                                                                    */
+/* Inputs:      The name of the protocol                              */
+/*                                                                    */
+/* Outputs:     The protocol, -1 if there is none with that name      */
+/**********************************************************************/
+int protocolName(const char *name){
+    for(int i = MESI; i <= MOESI; i++)
+        if(strcmp(name, protocolNames[i]) == 0)
+            return i;
+    return -1;
+}
+
+/**********************************************************************/
+/* Name:        coherenceInit                                         */
+/*                                                                    */
+/* Description: This function will create the private caches of the   */
+/*              cores, all with the same configuration                */
+/*                                                                    */
+/* Inputs:      The coherence state; the number of cores; the         */
+/*              protocol; the configuration of the caches             */
+/*                                                                    */
+/* Outputs:     0 on success, -1 on a bad configuration or no memory  */
+/**********************************************************************/
+int coherenceInit(struct coherence *coherence, int count, int protocol,
+                  const struct cacheConfig *config){
+
+    memset(coherence, 0, sizeof(*coherence));
+    if(count < 1 || count > MAXCORES)
+        return -1;
+    coherence->protocol = protocol;
+    coherence->lineSize = config->lineSize;
+
+    /* A line is tracked in at most 64 words of at least 8 bytes */
+    coherence->wordShift = 3;
+    while((config->lineSize >> coherence->wordShift) > 64)
+        coherence->wordShift++;
+
+    for(int i = 0; i < count; i++){
+        struct core *core = &coherence->cores[i];
+        if(cacheInit(&core->cache, config) != 0)
+            return -1;
+        coherence->count++;
+        core->touched = calloc((size_t)config->sets * config->ways, sizeof(unsigned long long));
+        if(core->touched == NULL)
+            return -1;
+    }
+    return 0;
+}
+
+/**********************************************************************/
+/* Name:        coherenceFree                                         */
+/*                                                                    */
+/* Description: This function will release the caches of the cores    */
+/*                                                                    */
+/* Inputs:      The coherence state                                   */
+/*                                                                    */
+/* Outputs:     NONE                                                  */
+/**********************************************************************/
+void coherenceFree(struct coherence *coherence){
+    for(int i = 0; i < coherence->count; i++){
+        cacheFree(&coherence->cores[i].cache);
+        free(coherence->cores[i].touched);
+    }
+    coherence->count = 0;
+}
+
+/**********************************************************************/
+/* Name:        snoop                                                 */
+/*                                                                    */
+/* Description: This function will find the entry of a line in the    */
+/*              cache of another core, without changing its           */
+/*              replacement metadata                                  */
+/*                                                                    */
+/* Inputs:      The cache; an address in decimal format               */
+/*                                                                    */
+/* Outputs:     The entry, NULL if the line is not in the cache       */
+/**********************************************************************/
+struct cache *snoop(struct cacheEngine *cache, unsigned long long address){
+
+    unsigned long long line = address >> cache->offsetBits;
+    unsigned int set = (unsigned int)line & cache->setMask;
+    unsigned int j = cacheFind(cache, set, line << cache->offsetBits);
+
+    if(j == NOENTRY)
+        return NULL;
+    return &cache->entries[(size_t)set * cache->ways + j];
+}
+
+/**********************************************************************/
+/* Name:        invalidateOthers                                      */
+/*                                                                    */
+/* Description: This function will remove a line from the caches of    */
+/*              every other core, before a core writes a word of it   */
+/*                                                                    */
+/* Inputs:      The coherence state; the writing core; the address;   */
+/*              the bit of the written word                           */
+/*                                                                    */
+/* Outputs:     1 if another core held the line, 0 otherwise          */
+/**********************************************************************/
+int invalidateOthers(struct coherence *coherence, int writer, unsigned long long address,
+                     unsigned long long word){
+
+    int held = 0;
+
+    for(int i = 0; i < coherence->count; i++){
+        struct core *core = &coherence->cores[i];
+        struct cache *entry;
+        if(i == writer || (entry = snoop(&core->cache, address)) == NULL)
+            continue;
+        held = 1;
+        core->invalidations++;
+        if(!(core->touched[entry - core->cache.entries] & word))
+            core->falseSharing++;
+        cacheInvalidate(&core->cache, address);
+    }
+    return held;
+}
+
+/**********************************************************************/
+/* Name:        coherenceAccess                                       */
+/*                                                                    */
+/* Description: This function will simulate a read or a write of a    */
+/*              core, with the bus transactions it causes in the      */
+/*              caches of the other cores                             */
+/*                                                                    */
+/* Inputs:      The coherence state; the core; the address; the type  */
+/*              of access                                             */
+/*                                                                    */
+/* Outputs:     1 on a hit, 0 on a miss                               */
+/**********************************************************************/
+int coherenceAccess(struct coherence *coherence, int id, unsigned long long address, int type){
+
+    struct core *self = &coherence->cores[id];
+    unsigned long long word = 1ull << ((address & (coherence->lineSize - 1)) >> coherence->wordShift);
+    struct cache *entry = cacheLookup(&self->cache, address);
+    struct eviction evicted;
+    int shared = 0;
+
+    self->accesses++;
+    if(entry != NULL){
+        self->hits++;
+        self->touched[entry - self->cache.entries] |= word;
+
+        /* A write to a line that others may hold needs an upgrade */
+        if(type == WRITE && entry->coherence != M_STATE){
+            if(entry->coherence != E_STATE){
+                coherence->busUpgrades++;
+                invalidateOthers(coherence, id, address, word);
+            }
+            entry->coherence = M_STATE;
+        }
+        return 1;
+    }
+    self->misses++;
+
+    if(type == WRITE){
+        /* Read for ownership: any other copy supplies the line and is
+        invalidated */
+        coherence->busReadsExclusive++;
+        shared = invalidateOthers(coherence, id, address, word);
+    }
+    else{
+        coherence->busReads++;
+        for(int i = 0; i < coherence->count; i++){
+            struct cache *other;
+            if(i == id || (other = snoop(&coherence->cores[i].cache, address)) == NULL)
+                continue;
+            shared = 1;
+            if(other->coherence == M_STATE){
+                /* MESI writes the line back; MOESI keeps it dirty in the
+                owner */
+                if(coherence->protocol == MOESI)
+                    other->coherence = O_STATE;
+                else{
+                    other->coherence = S_STATE;
+                    coherence->writebacks++;
+                    coherence->busBytes += coherence->lineSize;
+                }
+            }
+            else if(other->coherence == E_STATE)
+                other->coherence = S_STATE;
+        }
+    }
+    if(shared)
+        coherence->transfers++;
+    else
+        coherence->memoryReads++;
+    coherence->busBytes += coherence->lineSize;
+
+    entry = cacheFill(&self->cache, address, &evicted);
+    if(evicted.valid && (evicted.line.coherence == M_STATE ||
+                         evicted.line.coherence == O_STATE)){
+        coherence->writebacks++;
+        coherence->busBytes += coherence->lineSize;
+    }
+    if(type == WRITE)
+        entry->coherence = M_STATE;
+    else
+        entry->coherence = shared ? S_STATE : E_STATE;
+    self->touched[entry - self->cache.entries] = word;
+    return 0;
+}
+
+/**********************************************************************/
+/* Name:        coherenceStatistics                                   */
+/*                                                                    */
+/* Description: This function will print the hits, misses and          */
+/*              invalidations of every core and the bus traffic       */
+/*                                                                    */
+/* Inputs:      The coherence state                                   */
+/*                                                                    */
+/* Outputs:     NONE                                                  */
+/**********************************************************************/
+void coherenceStatistics(struct coherence *coherence){
+
+    printf("------------------------------------------------------------------------------\n");
+    printf("| CORE |   ACCESSES   |     HITS     |    MISSES    | INVALIDATED  |  FALSE  |\n");
+    printf("------------------------------------------------------------------------------\n");
+    for(int i = 0; i < coherence->count; i++){
+        struct core *core = &coherence->cores[i];
+        printf("| %4d | %12llu | %12llu | %12llu | %12llu | %7llu |\n", i, core->accesses,
+               core->hits, core->misses, core->invalidations, core->falseSharing);
+    }
+    printf("------------------------------------------------------------------------------\n");
+    printf("Protocol %s: %llu bus reads, %llu reads for ownership, %llu upgrades, "
+           "%llu writebacks\n", protocolNames[coherence->protocol], coherence->busReads,
+           coherence->busReadsExclusive, coherence->busUpgrades, coherence->writebacks);
+    printf("%llu cache-to-cache transfers, %llu memory reads, %llu bytes on the bus\n\n",
+           coherence->transfers, coherence->memoryReads, coherence->busBytes);
+}
+
+#endif
@@ -0,0 +1,233 @@
+#define _DEFAULT_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "CacheEngine.h"
+#include "Coherence.h"
+#include "Trace.h"
+
+#define TRACEBATCH 4096
+#define FINISHED   -1
+
+/* The cores take turns on the bus: the core holding the turn simulates
+quantum accesses and passes it to the next core that has not finished.
+The order only depends on the traces and the quantum, so every run gives
+the same result, while the cores still parse their traces in parallel */
+struct bus{
+    struct coherence *coherence;
+    pthread_mutex_t  lock;
+    pthread_cond_t   changed;
+    int              turn;          /* Core holding the turn, or FINISHED */
+    int              finished[MAXCORES];
+    unsigned int     quantum;
+};
+
+struct coreThread{
+    struct bus   *bus;
+    int          id;
+    struct trace trace;
+    unsigned int addresses[TRACEBATCH];
+    unsigned char types[TRACEBATCH];
+    size_t       count;             /* Accesses in the batch */
+    size_t       next;              /* Next access of the batch */
+};
+
+/**********************************************************************/
+/* Name:        passTurn                                              */
+/*                                                                    */
+/* Description: This function will give the turn to the next core that */
+/*              has not finished; it must be called with the lock     */
+/*                                                                    */
+/* Inputs:      The bus; the core that holds the turn                 */
+/*                                                                    */
+/* Outputs:     NONE                                                  */
+/**********************************************************************/
+void passTurn(struct bus *bus, int id){
+
+    int count = bus->coherence->count;
+
+    bus->turn = FINISHED;
+    for(int i = 1; i <= count; i++){
+        int next = (id + i) % count;
+        if(!bus->finished[next]){
+            bus->turn = next;
+            break;
+        }
+    }
+    pthread_cond_broadcast(&bus->changed);
+}
+
+/**********************************************************************/
+/* Name:        coreMain                                              */
+/*                                                                    */
+/* Description: This function will run the trace of a core, one       */
+/*              quantum per turn, until it ends or the run is         */
+/*              stopped. The next batch of the trace is parsed after  */
+/*              giving the turn away                                  */
+/*                                                                    */
+/* Inputs:      The core thread                                       */
+/*                                                                    */
+/* Outputs:     NULL                                                  */
+/**********************************************************************/
+void *coreMain(void *argument){
+
+    struct coreThread *core = argument;
+    struct bus *bus = core->bus;
+
+    for(;;){
+        pthread_mutex_lock(&bus->lock);
+        while(bus->turn != core->id && bus->turn != FINISHED)
+            pthread_cond_wait(&bus->changed, &bus->lock);
+        int stopped = bus->turn == FINISHED;
+        pthread_mutex_unlock(&bus->lock);
+        if(stopped)
+            break;
+
+        /* The other cores are waiting, so the caches can be used
+        without the lock */
+        unsigned int done = 0;
+        while(done < bus->quantum){
+            if(core->next == core->count){
+                core->count = traceReadAccesses(&core->trace, core->addresses, core->types, NULL,
+                                                TRACEBATCH);
+                core->next = 0;
+                if(core->count == 0)
+                    break;
+            }
+            coherenceAccess(bus->coherence, core->id, core->addresses[core->next],
+                            core->types[core->next]);
+            core->next++;
+            done++;
+        }
+
+        pthread_mutex_lock(&bus->lock);
+        if(done < bus->quantum)
+            bus->finished[core->id] = 1;
+        passTurn(bus, core->id);
+        pthread_mutex_unlock(&bus->lock);
+        if(bus->finished[core->id])
+            break;
+
+        if(core->next == core->count){
+            core->count = traceReadAccesses(&core->trace, core->addresses, core->types, NULL,
+                                            TRACEBATCH);
+            core->next = 0;
+        }
+    }
+    return NULL;
+}
+
+int main(int argc, char *argv[]){
+
+    struct cacheConfig config = { 64, 8, 64, LRU, WRITEBACK, WRITEALLOCATE };
+    int                protocol = MESI;
+    int                option;
+    int                status = 0;
+
+    static struct coherence coherence;
+    static struct bus       bus;
+    static struct coreThread cores[MAXCORES];
+    pthread_t               thread[MAXCORES];
+    int                     started[MAXCORES];
+    int                     standIn = -1;   /* Core run by the main thread */
+
+    bus.quantum = 64;
+    while((option = getopt(argc, argv, "s:w:b:p:P:q:")) != -1){
+        switch(option){
+          case 's':
+              config.sets = (unsigned int)strtoul(optarg, NULL, 0);
+              break;
+          case 'w':
+              config.ways = (unsigned int)strtoul(optarg, NULL, 0);
+              break;
+          case 'b':
+              config.lineSize = (unsigned int)strtoul(optarg, NULL, 0);
+              break;
+          case 'p':
+              config.policy = policyName(optarg);
+              break;
+          case 'P':
+              protocol = protocolName(optarg);
+              break;
+          case 'q':
+              bus.quantum = (unsigned int)strtoul(optarg, NULL, 0);
+              break;
+          default :
+              protocol = -1;
+        }
+    }
+    int count = argc - optind;
+    if(protocol < 0 || count < 1 || count > MAXCORES || bus.quantum == 0){
+        fprintf(stderr, "usage: %s [-s sets] [-w ways] [-b line size] [-p policy] "
+                "[-P mesi|moesi] [-q quantum] <trace of core 0> [trace of core 1]...\n", argv[0]);
+        fprintf(stderr, "  trace lines may start with R or W; the cores take turns of "
+                "quantum accesses\n");
+        return 1;
+    }
+
+    if(coherenceInit(&coherence, count, protocol, &config) != 0){
+        fprintf(stderr, "%s: invalid cache configuration\n", argv[0]);
+        coherenceFree(&coherence);
+        return 1;
+    }
+    for(int i = 0; i < count; i++){
+        if(traceOpen(&cores[i].trace, argv[optind + i]) != 0){
+            fprintf(stderr, "%s: cannot read %s\n", argv[0], argv[optind + i]);
+            return 1;
+        }
+        cores[i].bus = &bus;
+        cores[i].id = i;
+    }
+
+    bus.coherence = &coherence;
+    bus.turn = 0;
+    pthread_mutex_init(&bus.lock, NULL);
+    pthread_cond_init(&bus.changed, NULL);
+    for(int i = 0; i < count; i++)
+        started[i] = pthread_create(&thread[i], NULL, coreMain, &cores[i]) == 0;
+
+    /* The main thread takes the place of a core that did not start; the
+    turns keep the result the same. It can only stand in for one, so with
+    more the run is stopped: every core is finished and the turn ends */
+    for(int i = 0; i < count; i++){
+        if(started[i])
+            continue;
+        fprintf(stderr, "%s: cannot start the thread of core %d", argv[0], i);
+        if(standIn < 0){
+            fprintf(stderr, ", the main thread takes its place\n");
+            standIn = i;
+            continue;
+        }
+        fprintf(stderr, "\n");
+        pthread_mutex_lock(&bus.lock);
+        for(int j = 0; j < count; j++)
+            bus.finished[j] = 1;
+        bus.turn = FINISHED;
+        pthread_cond_broadcast(&bus.changed);
+        pthread_mutex_unlock(&bus.lock);
+        status = 1;
+        break;
+    }
+    if(standIn >= 0 && status == 0)
+        coreMain(&cores[standIn]);
+    for(int i = 0; i < count; i++){
+        if(started[i])
+            pthread_join(thread[i], NULL);
+        if(traceClose(&cores[i].trace) != 0 && status == 0){
+            fprintf(stderr, "%s: %s is truncated or corrupt\n", argv[0], argv[optind + i]);
+            status = 1;
+        }
+    }
+    if(status != 0){
+        coherenceFree(&coherence);
+        return status;
+    }
+
+    coherenceStatistics(&coherence);
+    coherenceFree(&coherence);
+    return 0;
+}
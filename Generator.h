@@ -0,0 +1,128 @@
+#ifndef GENERATOR_H
+#define GENERATOR_H
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Synthetic access patterns. The addresses fall in a footprint of a power
+of two bytes; the random patterns work on 64 byte lines of it */
+enum pattern { SEQUENTIAL = 0, STRIDED, UNIFORM, ZIPF, POINTERCHASE };
+
+const char *patternNames[] = { "sequential", "strided", "uniform", "zipf", "chase" };
+
+#define GENERATORLINE 64
+
+/* Parameters of a synthetic trace */
+struct generator{
+    int          pattern;
+    unsigned int footprint;     /* Bytes, a power of two */
+    unsigned int stride;        /* Bytes between strided accesses */
+    double       skew;          /* Exponent of the Zipf distribution */
+    unsigned int seed;
+};
+
+/**********************************************************************/
+/* Name:        generatorRandom                                       */
+/*                                                                    */
+/* Description: This function will return the next number of a        */
+/*              xorshift sequence                                     */
+/*                                                                    */
+/* Inputs:      The state of the sequence, never 0                    */
+/*                                                                    */
+/* Outputs:     The number                                            */
+/**********************************************************************/
+unsigned int generatorRandom(unsigned int *state){
+    unsigned int x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return *state = x;
+}
+
+/**********************************************************************/
+/* Name:        generateTrace                                         */
+/*                                                                    */
+/* Description: This function will fill an array with the addresses   */
+/*              of a synthetic pattern. Zipf ranks are spread over    */
+/*              the footprint by an odd multiplier, so popular lines  */
+/*              are not neighbours, and the pointer chase follows a   */
+/*              single random cycle through every line                */
+/*                                                                    */
+/* Inputs:      The generator; the array; its length                  */
+/*                                                                    */
+/* Outputs:     0 on success, -1 on bad parameters or no memory       */
+/**********************************************************************/
+int generateTrace(const struct generator *generator, unsigned int addresses[], size_t count){
+
+    unsigned int mask = generator->footprint - 1;
+    unsigned int lines = generator->footprint / GENERATORLINE;
+    unsigned int state = generator->seed ? generator->seed : 1;
+    unsigned int address = 0;
+
+    if(generator->footprint == 0 || (generator->footprint & mask) != 0 || lines == 0)
+        return -1;
+
+    switch(generator->pattern){
+      case SEQUENTIAL:
+      case STRIDED:{
+          unsigned int step = generator->pattern == SEQUENTIAL ? 4 : generator->stride;
+          for(size_t i = 0; i < count; i++, address += step)
+              addresses[i] = address & mask;
+          return 0;
+      }
+      case UNIFORM:
+          for(size_t i = 0; i < count; i++)
+              addresses[i] = (generatorRandom(&state) & mask) & ~3u;
+          return 0;
+      case ZIPF:{
+          /* Inverse of the cumulative distribution by binary search */
+          double *cumulative = malloc(lines * sizeof(double));
+          double total = 0.0;
+          if(cumulative == NULL)
+              return -1;
+          for(unsigned int k = 0; k < lines; k++){
+              total += 1.0 / pow(k + 1.0, generator->skew);
+              cumulative[k] = total;
+          }
+          for(size_t i = 0; i < count; i++){
+              double u = generatorRandom(&state) / 4294967296.0 * total;
+              unsigned int low = 0, high = lines - 1;
+              while(low < high){
+                  unsigned int middle = (low + high) / 2;
+                  if(cumulative[middle] < u)
+                      low = middle + 1;
+                  else
+                      high = middle;
+              }
+              addresses[i] = ((low * 2654435761u) & (lines - 1)) * GENERATORLINE;
+          }
+          free(cumulative);
+          return 0;
+      }
+      case POINTERCHASE:{
+          /* Sattolo's shuffle gives a permutation with a single cycle */
+          unsigned int *next = malloc(lines * sizeof(unsigned int));
+          unsigned int line = 0;
+          if(next == NULL)
+              return -1;
+          for(unsigned int k = 0; k < lines; k++)
+              next[k] = k;
+          for(unsigned int k = lines - 1; k > 0; k--){
+              unsigned int j = generatorRandom(&state) % k;
+              unsigned int swap = next[k];
+              next[k] = next[j];
+              next[j] = swap;
+          }
+          for(size_t i = 0; i < count; i++){
+              addresses[i] = line * GENERATORLINE;
+              line = next[line];
+          }
+          free(next);
+          return 0;
+      }
+    }
+    return -1;
+}
+
+#endif
@@ -0,0 +1,167 @@
+#ifndef HIERARCHY_H
+#define HIERARCHY_H
+
+#include <stdio.h>
+#include <string.h>
+
+#include "CacheEngine.h"
+
+#define MAXLEVELS 4
+
+/* How the lines of a level relate to the lines of the levels above it.
+An inclusive level holds every line above it and invalidates them when it
+evicts one; an exclusive level only holds the victims of the level above
+and gives a line up when it hits; a NINE level is filled on every miss and
+does not enforce either property */
+enum inclusion { NINE = 0, INCLUSIVE, EXCLUSIVE };
+
+const char *inclusionNames[] = { "nine", "inclusive", "exclusive" };
+
+struct level{
+    struct cacheEngine cache;
+    int                inclusion;
+    unsigned int       latency;     /* Cycles to look the level up */
+    unsigned long long hits;
+    unsigned long long misses;
+    unsigned long long backInvalidations;
+};
+
+/* L1 is level 0; a miss in the last level goes to memory */
+struct hierarchy{
+    struct level       levels[MAXLEVELS];
+    int                count;
+    unsigned int       memoryLatency;
+    unsigned long long accesses;
+    unsigned long long cycles;      /* Total latency of all the accesses */
+};
+
+/**********************************************************************/
+/* Name:        inclusionName                                         */
+/*                                                                    */
+/* Description: This function will find the inclusion property with a */
+/*              given name                                            */
+/*                                                                    */
+/* Inputs:      The name of the property                              */
+/*                                                                    */
+/* Outputs:     The property, -1 if there is none with that name      */
+/**********************************************************************/
+int inclusionName(const char *name){
+    for(int i = NINE; i <= EXCLUSIVE; i++)
+        if(strcmp(name, inclusionNames[i]) == 0)
+            return i;
+    return -1;
+}
+
+/**********************************************************************/
+/* Name:        hierarchyVictim                                       */
+/*                                                                    */
+/* Description: This function will handle a line evicted from a level: */
+/*              an inclusive level removes it from the levels above,  */
+/*              and an exclusive level below receives it              */
+/*                                                                    */
+/* Inputs:      The hierarchy; the level; the address of the line     */
+/*                                                                    */
+/* Outputs:     NONE                                                  */
+/**********************************************************************/
+void hierarchyVictim(struct hierarchy *hierarchy, int level, unsigned long long address){
+
+    struct eviction evicted;
+
+    if(level > 0 && hierarchy->levels[level].inclusion == INCLUSIVE)
+        for(int i = 0; i < level; i++)
+            hierarchy->levels[level].backInvalidations +=
+                cacheInvalidate(&hierarchy->levels[i].cache, address);
+
+    if(level + 1 < hierarchy->count && hierarchy->levels[level + 1].inclusion == EXCLUSIVE){
+        struct cacheEngine *below = &hierarchy->levels[level + 1].cache;
+        if(!cacheProbe(below, address)){
+            cacheFill(below, address, &evicted);
+            if(evicted.valid)
+                hierarchyVictim(hierarchy, level + 1, evicted.line.address);
+        }
+    }
+}
+
+/**********************************************************************/
+/* Name:        hierarchyAccess                                       */
+/*                                                                    */
+/* Description: This function will look an address up in every level  */
+/*              until one hits, add the latency of the levels it went */
+/*              through and fill the line into the levels above       */
+/*                                                                    */
+/* Inputs:      The hierarchy; an address in decimal format           */
+/*                                                                    */
+/* Outputs:     The level that hit, count if it went to memory        */
+/**********************************************************************/
+int hierarchyAccess(struct hierarchy *hierarchy, unsigned long long address){
+
+    struct eviction evicted;
+    int hit;
+
+    hierarchy->accesses++;
+    for(hit = 0; hit < hierarchy->count; hit++){
+        struct level *level = &hierarchy->levels[hit];
+        hierarchy->cycles += level->latency;
+        if(cacheProbe(&level->cache, address)){
+            level->hits++;
+            break;
+        }
+        level->misses++;
+    }
+    if(hit == hierarchy->count)
+        hierarchy->cycles += hierarchy->memoryLatency;
+
+    /* The line moves up out of an exclusive level */
+    else if(hit > 0 && hierarchy->levels[hit].inclusion == EXCLUSIVE)
+        cacheInvalidate(&hierarchy->levels[hit].cache, address);
+
+    /* Fill the levels above, the deepest first, so an inclusive level
+    evicts before the levels it covers are filled; exclusive levels only
+    receive victims */
+    for(int i = hit - 1; i >= 0; i--){
+        if(i > 0 && hierarchy->levels[i].inclusion == EXCLUSIVE)
+            continue;
+        cacheFill(&hierarchy->levels[i].cache, address, &evicted);
+        if(evicted.valid)
+            hierarchyVictim(hierarchy, i, evicted.line.address);
+    }
+    return hit;
+}
+
+/**********************************************************************/
+/* Name:        hierarchyStatistics                                   */
+/*                                                                    */
+/* Description: This function will print the hits, misses and local   */
+/*              hit rate of every level and the average memory access */
+/*              time                                                  */
+/*                                                                    */
+/* Inputs:      The hierarchy                                         */
+/*                                                                    */
+/* Outputs:     NONE                                                  */
+/**********************************************************************/
+void hierarchyStatistics(struct hierarchy *hierarchy){
+
+    printf("------------------------------------------------------------------------\n");
+    printf("| LEVEL | INCLUSION |     HITS     |    MISSES    | HIT RATE | LATENCY |\n");
+    printf("------------------------------------------------------------------------\n");
+    for(int i = 0; i < hierarchy->count; i++){
+        struct level *level = &hierarchy->levels[i];
+        unsigned long long lookups = level->hits + level->misses;
+        printf("|  L%d   | %-9s | %12llu | %12llu | %.6f | %7u |\n", i + 1,
+               i == 0 ? "-" : inclusionNames[level->inclusion], level->hits, level->misses,
+               lookups ? level->hits/(double)lookups : 0.0, level->latency);
+    }
+    printf("|  MEM  | %-9s | %12llu | %12s | %8s | %7u |\n", "-",
+           hierarchy->count ? hierarchy->levels[hierarchy->count - 1].misses : 0, "-", "-",
+           hierarchy->memoryLatency);
+    printf("------------------------------------------------------------------------\n");
+    for(int i = 1; i < hierarchy->count; i++)
+        if(hierarchy->levels[i].backInvalidations)
+            printf("L%d back-invalidated %llu lines\n", i + 1,
+                   hierarchy->levels[i].backInvalidations);
+    printf("AMAT = %.3f cycles over %llu accesses\n\n",
+           hierarchy->accesses ? hierarchy->cycles/(double)hierarchy->accesses : 0.0,
+           hierarchy->accesses);
+}
+
+#endif
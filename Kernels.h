@@ -0,0 +1,176 @@
+#ifndef KERNELS_H
+#define KERNELS_H
+
+#include <stddef.h>
+
+#include "CacheEngine.h"
+
+/* A kernel simulates a batch of reads of unknown size, leaving the cache
+exactly as cacheAccess would for every address */
+typedef void (*cacheKernel)(struct cacheEngine *cache, const unsigned int addresses[],
+                            size_t count);
+
+/* The body is expanded once per kernel with its geometry as constants, so
+the compiler drops the shift and unrolls the loops over the ways */
+#ifdef __GNUC__
+#define KERNELINLINE static inline __attribute__((always_inline))
+#else
+#define KERNELINLINE static inline
+#endif
+
+/**********************************************************************/
+/* Name:        kernelBody                                            */
+/*                                                                    */
+/* Description: This function will simulate a batch of reads in a     */
+/*              set associative cache under FIFO or LRU without the   */
+/*              hash index. Hits, fills and dirty evictions are       */
+/*              counted as cacheReferenceLine counts them             */
+/*                                                                    */
+/* Inputs:      The cache; the addresses; their number; the ways, the */
+/*              policy and log2 of the line size, all constants       */
+/*                                                                    */
+/* Outputs:     NONE                                                  */
+/**********************************************************************/
+KERNELINLINE void kernelBody(struct cacheEngine *cache, const unsigned int addresses[],
+                             size_t count, const unsigned int ways, const int policy,
+                             const unsigned int offsetBits){
+
+    struct cache *entries = cache->entries;
+    unsigned long long *tags = cache->tags;
+    unsigned char *states = cache->states;
+    unsigned long long *timers = cache->timers;
+    unsigned int setMask = cache->setMask;
+    unsigned long long timer = cache->timer;
+    unsigned long long hits = 0;
+    unsigned long long fills = 0, writebacks = 0;
+
+    for(size_t i = 0; i < count; i++){
+        unsigned int line = addresses[i] >> offsetBits;
+        unsigned int set = line & setMask;
+        unsigned long long tag = (unsigned long long)line << offsetBits;
+        struct cache *entry = &entries[(size_t)set * ways];
+        unsigned long long *setTags = &tags[(size_t)set * ways];
+        unsigned char *setStates = &states[(size_t)set * ways];
+        unsigned long long *setTimers = &timers[(size_t)set * ways];
+        unsigned int way = NOENTRY;
+
+        /* A line is valid in at most one way, so the scan does not stop
+        early and the compiler can turn it into vector compares */
+#pragma GCC unroll 16
+        for(unsigned int j = 0; j < ways; j++)
+            if(setTags[j] == tag && setStates[j] == VALID)
+                way = j;
+        if(way != NOENTRY){
+            setTimers[way] = timer++;
+            hits++;
+            continue;
+        }
+
+        if(cache->filled[set] < ways){
+            for(way = 0; setStates[way] == VALID; way++)
+                ;
+            cache->filled[set]++;
+            if(policy == FIFO)
+                cache->victim[set] = (way + 1 == ways) ? 0 : way + 1;
+        }
+        else if(policy == FIFO){
+            way = cache->victim[set];
+            cache->victim[set] = (way + 1 == ways) ? 0 : way + 1;
+        }
+        else{
+            way = 0;
+#pragma GCC unroll 16
+            for(unsigned int j = 1; j < ways; j++)
+                if(setTimers[j] < setTimers[way])
+                    way = j;
+        }
+        if(setStates[way] == VALID && entry[way].dirty)
+            writebacks++;
+
+        fills++;
+        entry[way].coherence = 0;
+        entry[way].dirty = 0;
+        entry[way].prefetched = 0;
+        entry[way].address = tag;
+        setStates[way] = VALID;
+        setTimers[way] = timer++;
+        setTags[way] = tag;
+    }
+
+    cache->timer = timer;
+    cache->hits += hits;
+    cache->events += count;
+    cache->fillBytes += fills << offsetBits;
+    cache->writebacks += writebacks;
+    cache->writebackBytes += writebacks << offsetBits;
+}
+
+/**********************************************************************/
+/* Name:        kernelGeneric                                         */
+/*                                                                    */
+/* Description: This function will simulate a batch of reads through  */
+/*              the engine, for the caches without a kernel           */
+/*                                                                    */
+/* Inputs:      The cache; the addresses; their number                */
+/*                                                                    */
+/* Outputs:     NONE                                                  */
+/**********************************************************************/
+void kernelGeneric(struct cacheEngine *cache, const unsigned int addresses[], size_t count){
+    for(size_t i = 0; i < count; i++)
+        cacheReferenceLine(cache, addresses[i], READ, ACCESSSIZE);
+}
+
+/* The specialized geometries: every policy and line size below with
+every number of ways */
+#define KERNELWAYS(X, policy, offsetBits) \
+    X(1, policy, offsetBits) X(2, policy, offsetBits) X(4, policy, offsetBits) \
+    X(8, policy, offsetBits) X(16, policy, offsetBits)
+
+#define KERNELS(X) \
+    KERNELWAYS(X, FIFO, 0) KERNELWAYS(X, FIFO, 5) KERNELWAYS(X, FIFO, 6) \
+    KERNELWAYS(X, LRU, 0)  KERNELWAYS(X, LRU, 5)  KERNELWAYS(X, LRU, 6)
+
+#define KERNELDEFINE(ways, policy, offsetBits) \
+    void kernel_##policy##_##ways##_##offsetBits(struct cacheEngine *cache, \
+                                                 const unsigned int addresses[], size_t count){ \
+        kernelBody(cache, addresses, count, ways, policy, offsetBits); \
+    }
+
+KERNELS(KERNELDEFINE)
+
+struct kernelEntry{
+    unsigned int ways;
+    int          policy;
+    unsigned int offsetBits;
+    cacheKernel  kernel;
+};
+
+#define KERNELENTRY(ways, policy, offsetBits) \
+    { ways, policy, offsetBits, kernel_##policy##_##ways##_##offsetBits },
+
+const struct kernelEntry kernelTable[] = { KERNELS(KERNELENTRY) };
+
+/**********************************************************************/
+/* Name:        kernelSelect                                          */
+/*                                                                    */
+/* Description: This function will choose the kernel specialized for  */
+/*              the geometry and the policy of a cache, or the        */
+/*              generic one when there is none                        */
+/*                                                                    */
+/* Inputs:      The cache                                             */
+/*                                                                    */
+/* Outputs:     The kernel                                            */
+/**********************************************************************/
+cacheKernel kernelSelect(const struct cacheEngine *cache){
+
+    /* Large fully associative caches keep the hash index */
+    if(cache->bucket != NULL)
+        return kernelGeneric;
+    for(size_t i = 0; i < sizeof(kernelTable) / sizeof(kernelTable[0]); i++)
+        if(kernelTable[i].ways == cache->ways && kernelTable[i].policy == cache->policy &&
+           kernelTable[i].offsetBits == cache->offsetBits)
+            return kernelTable[i].kernel;
+    return kernelGeneric;
+}
+
+#endif
@@ -0,0 +1,284 @@
+#ifndef PARTITION_H
+#define PARTITION_H
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "CacheEngine.h"
+#include "TraceRing.h"
+
+/* Line accesses in a batch of a worker, and batches queued per worker; a
+power of two so the positions wrap with a mask */
+#define PARTITIONBATCH  4096
+#define PARTITIONBLOCKS 8
+
+/* Line accesses routed to a worker, each with the value the timer of the
+cache has when a serial run reaches it. A serial run does not move the
+timer on a write miss that goes around the cache, so without write allocate
+the timers of the entries are later than serial ones, in the same order */
+struct partitionBatch{
+    unsigned long long addresses[PARTITIONBATCH];
+    unsigned long long timers[PARTITIONBATCH];
+    unsigned char      types[PARTITIONBATCH];
+    unsigned char      sizes[PARTITIONBATCH];
+    size_t             count;       /* 0 for the last batch */
+};
+
+/* A worker owns a contiguous range of sets. Its cache is a copy of the
+engine that shares the entries and the arrays of the policies, which it
+only touches in its own sets, and keeps its own counters. The batches are
+a ring like the one of TraceRing.h, filled by the router */
+struct partitionWorker{
+    struct cacheEngine    cache;
+    struct partitionBatch *batches;
+    size_t                pending;  /* Accesses in the batch being filled */
+    pthread_t             thread;
+    struct ringSignal     signal;
+    _Alignas(64) atomic_size_t head;   /* Batches routed */
+    _Alignas(64) atomic_size_t tail;   /* Batches simulated */
+};
+
+/* A cache simulated by several workers, and the timer of the next line
+access. Worker w owns the sets s with s * count / sets == w; sets is a
+power of two, so the divide is a shift */
+struct partition{
+    struct cacheEngine     *cache;
+    struct partitionWorker *workers;
+    unsigned int           count;
+    unsigned int           setBits;     /* log2(sets) */
+    unsigned long long     timer;
+};
+
+/**********************************************************************/
+/* Name:        partitionWorker                                       */
+/*                                                                    */
+/* Description: This function will simulate the batches of a worker    */
+/*              until the last one                                    */
+/*                                                                    */
+/* Inputs:      The worker                                            */
+/*                                                                    */
+/* Outputs:     NULL                                                  */
+/**********************************************************************/
+void *partitionWorker(void *argument){
+
+    struct partitionWorker *worker = argument;
+    size_t tail = 0;
+
+    for(;;){
+        unsigned int polls = 0;
+        while(atomic_load_explicit(&worker->head, memory_order_acquire) == tail)
+            ringWait(&worker->signal, &worker->head, tail, &polls, 0.0);
+
+        struct partitionBatch *batch = &worker->batches[tail & (PARTITIONBLOCKS - 1)];
+        size_t count = batch->count;
+        for(size_t i = 0; i < count; i++){
+            worker->cache.timer = batch->timers[i];
+            cacheReferenceLine(&worker->cache, batch->addresses[i], batch->types[i],
+                               batch->sizes[i]);
+        }
+        atomic_store_explicit(&worker->tail, ++tail, memory_order_release);
+        ringNotify(&worker->signal);
+        if(count == 0)
+            return NULL;
+    }
+}
+
+/**********************************************************************/
+/* Name:        partitionPublish                                      */
+/*                                                                    */
+/* Description: This function will hand the batch being filled to its  */
+/*              worker                                                */
+/*                                                                    */
+/* Inputs:      The worker                                            */
+/*                                                                    */
+/* Outputs:     NONE                                                  */
+/**********************************************************************/
+void partitionPublish(struct partitionWorker *worker){
+
+    size_t head = atomic_load_explicit(&worker->head, memory_order_relaxed);
+
+    worker->batches[head & (PARTITIONBLOCKS - 1)].count = worker->pending;
+    worker->pending = 0;
+    atomic_store_explicit(&worker->head, head + 1, memory_order_release);
+    ringNotify(&worker->signal);
+}
+
+/**********************************************************************/
+/* Name:        partitionSlot                                         */
+/*                                                                    */
+/* Description: This function will return the batch being filled for   */
+/*              a worker, waiting for a free one when a new batch     */
+/*              starts                                                */
+/*                                                                    */
+/* Inputs:      The worker                                            */
+/*                                                                    */
+/* Outputs:     The batch                                             */
+/**********************************************************************/
+struct partitionBatch *partitionSlot(struct partitionWorker *worker){
+
+    size_t head = atomic_load_explicit(&worker->head, memory_order_relaxed);
+
+    if(worker->pending == 0){
+        unsigned int polls = 0;
+        while(head - atomic_load_explicit(&worker->tail, memory_order_acquire) == PARTITIONBLOCKS)
+            ringWait(&worker->signal, &worker->tail, head - PARTITIONBLOCKS, &polls, 0.0);
+    }
+    return &worker->batches[head & (PARTITIONBLOCKS - 1)];
+}
+
+/**********************************************************************/
+/* Name:        partitionInit                                         */
+/*                                                                    */
+/* Description: This function will split the sets of a cache among a   */
+/*              number of workers and start them                      */
+/*                                                                    */
+/* Inputs:      The partition; the cache; the number of workers, at   */
+/*              most the number of sets                               */
+/*                                                                    */
+/* Outputs:     0 on success, -1 if there is no memory or no thread   */
+/**********************************************************************/
+int partitionInit(struct partition *partition, struct cacheEngine *cache, unsigned int count){
+
+    memset(partition, 0, sizeof(*partition));
+    partition->cache = cache;
+    partition->timer = cache->timer;
+    while((1ull << partition->setBits) < cache->sets)
+        partition->setBits++;
+    partition->workers = calloc(count, sizeof(struct partitionWorker));
+    if(partition->workers == NULL)
+        return -1;
+
+    for(unsigned int w = 0; w < count; w++){
+        struct partitionWorker *worker = &partition->workers[w];
+        worker->cache = *cache;
+        cacheClearCounters(&worker->cache);
+        atomic_init(&worker->head, 0);
+        atomic_init(&worker->tail, 0);
+        if(ringSignalInit(&worker->signal) != 0)
+            break;
+        worker->batches = malloc(PARTITIONBLOCKS * sizeof(struct partitionBatch));
+        if(worker->batches == NULL ||
+           pthread_create(&worker->thread, NULL, partitionWorker, worker) != 0){
+            free(worker->batches);
+            ringSignalFree(&worker->signal);
+            break;
+        }
+        partition->count++;
+    }
+    if(partition->count == count)
+        return 0;
+
+    /* Stop the workers that did start */
+    for(unsigned int w = 0; w < partition->count; w++){
+        partitionSlot(&partition->workers[w]);
+        partitionPublish(&partition->workers[w]);
+        pthread_join(partition->workers[w].thread, NULL);
+        ringSignalFree(&partition->workers[w].signal);
+        free(partition->workers[w].batches);
+    }
+    free(partition->workers);
+    memset(partition, 0, sizeof(*partition));
+    return -1;
+}
+
+/**********************************************************************/
+/* Name:        partitionLine                                         */
+/*                                                                    */
+/* Description: This function will route an access inside one line to  */
+/*              the worker that owns its set                          */
+/*                                                                    */
+/* Inputs:      The partition; an address in decimal format; the type */
+/*              of access; the number of bytes                        */
+/*                                                                    */
+/* Outputs:     NONE                                                  */
+/**********************************************************************/
+void partitionLine(struct partition *partition, unsigned long long address, int type,
+                   unsigned int size){
+
+    struct cacheEngine *cache = partition->cache;
+    unsigned int set = (unsigned int)(address >> cache->offsetBits) & cache->setMask;
+    struct partitionWorker *worker =
+        &partition->workers[((unsigned long long)set * partition->count) >> partition->setBits];
+    struct partitionBatch *batch = partitionSlot(worker);
+    size_t i = worker->pending++;
+
+    batch->addresses[i] = address;
+    batch->timers[i] = partition->timer++;
+    batch->types[i] = (unsigned char)type;
+    batch->sizes[i] = (unsigned char)size;
+    if(worker->pending == PARTITIONBATCH)
+        partitionPublish(worker);
+}
+
+/**********************************************************************/
+/* Name:        partitionReference                                    */
+/*                                                                    */
+/* Description: This function will route an access like               */
+/*              cacheReference splits it, one piece per line          */
+/*                                                                    */
+/* Inputs:      The partition; an address in decimal format; the type */
+/*              of access; the number of bytes, 0 for one line        */
+/*                                                                    */
+/* Outputs:     NONE                                                  */
+/**********************************************************************/
+void partitionReference(struct partition *partition, unsigned long long address, int type,
+                        unsigned int size){
+
+    unsigned int lineSize = partition->cache->lineSize;
+    unsigned int offset = address & (lineSize - 1);
+
+    if(size == 0)
+        size = ACCESSSIZE < lineSize - offset ? ACCESSSIZE : lineSize - offset;
+    while(offset + size > lineSize){
+        unsigned int part = lineSize - offset;
+        partitionLine(partition, address, type, part);
+        address += part;
+        size -= part;
+        offset = 0;
+    }
+    partitionLine(partition, address, type, size);
+}
+
+/**********************************************************************/
+/* Name:        partitionFinish                                       */
+/*                                                                    */
+/* Description: This function will send the last batches, wait for the */
+/*              workers and add their counters to the cache           */
+/*                                                                    */
+/* Inputs:      The partition                                         */
+/*                                                                    */
+/* Outputs:     NONE                                                  */
+/**********************************************************************/
+void partitionFinish(struct partition *partition){
+
+    struct cacheEngine *cache = partition->cache;
+
+    for(unsigned int w = 0; w < partition->count; w++){
+        struct partitionWorker *worker = &partition->workers[w];
+        if(worker->pending > 0)
+            partitionPublish(worker);
+        partitionSlot(worker);
+        partitionPublish(worker);
+    }
+    for(unsigned int w = 0; w < partition->count; w++){
+        struct cacheEngine *part = &partition->workers[w].cache;
+        pthread_join(partition->workers[w].thread, NULL);
+        ringSignalFree(&partition->workers[w].signal);
+        free(partition->workers[w].batches);
+        cache->hits += part->hits;
+        cache->events += part->events;
+        cache->writes += part->writes;
+        cache->writeHits += part->writeHits;
+        cache->writebacks += part->writebacks;
+        cache->fillBytes += part->fillBytes;
+        cache->writebackBytes += part->writebackBytes;
+        cache->writeThroughBytes += part->writeThroughBytes;
+    }
+    cache->timer = partition->timer;
+    free(partition->workers);
+    memset(partition, 0, sizeof(*partition));
+}
+
+#endif
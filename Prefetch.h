@@ -0,0 +1,327 @@
+#ifndef PREFETCH_H
+#define PREFETCH_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "CacheEngine.h"
+
+/* Prefetchers that fill lines into the cache ahead of the demand accesses.
+The traces have no program counters, so the reference prediction table of
+the stride prefetcher is indexed by the page of the access instead */
+enum prefetcherKind { NOPREFETCH = 0, NEXTLINE, STRIDE, STREAM };
+
+const char *prefetcherNames[] = { "none", "nextline", "stride", "stream" };
+
+/* Lines fetched ahead by default, and demand accesses a prefetch takes to
+arrive. The fills of prefetches do not count, so a high degree does not
+make its own prefetches look timely */
+#define PREFETCHDEGREE  2
+#define PREFETCHLATENCY 16
+
+/* Reference prediction table: entries, pages of 4 KB and the confidence
+a stride needs before it is prefetched */
+#define RPTENTRIES    64
+#define RPTPAGEBITS   12
+#define RPTCONFIDENT  2
+#define RPTMAXCONFIDENCE 3
+
+/* Streams followed at once by the stream prefetcher */
+#define STREAMS 8
+
+/* Lines evicted by prefetches are remembered in a direct mapped filter; a
+demand miss to one of them is a miss the prefetcher caused */
+#define POLLUTIONFILTER 4096
+
+struct rptEntry{
+    unsigned long long page;
+    unsigned long long line;        /* Last line accessed in the page */
+    long long          stride;      /* In lines */
+    unsigned int       confidence;
+    int                valid;
+};
+
+struct stream{
+    unsigned long long line;        /* Last line of the stream */
+    int                direction;   /* 1 or -1, 0 until the second miss */
+    unsigned long long used;        /* Timer of the last use, for LRU */
+    int                valid;
+};
+
+struct prefetcher{
+    int                kind;
+    unsigned int       degree;      /* Lines fetched ahead */
+    struct rptEntry    table[RPTENTRIES];
+    struct stream      streams[STREAMS];
+    unsigned long long polluted[POLLUTIONFILTER];   /* Line + 1, 0 if empty */
+    unsigned long long misses;      /* Demand misses */
+    unsigned long long pollution;   /* Demand misses to lines a prefetch evicted */
+};
+
+/**********************************************************************/
+/* Name:        prefetcherInit                                        */
+/*                                                                    */
+/* Description: This function will prepare a prefetcher for a cache    */
+/*                                                                    */
+/* Inputs:      The prefetcher; the cache; the kind of prefetcher;    */
+/*              the lines fetched ahead; the latency of a prefetch in */
+/*              demand accesses                                       */
+/*                                                                    */
+/* Outputs:     0 on success, -1 on an unknown kind or no degree, -2  */
+/*              if there is no memory                                 */
+/**********************************************************************/
+int prefetcherInit(struct prefetcher *prefetcher, struct cacheEngine *cache, int kind,
+                   unsigned int degree, unsigned int latency){
+
+    memset(prefetcher, 0, sizeof(*prefetcher));
+    if(kind < NOPREFETCH || kind > STREAM || degree == 0)
+        return -1;
+    prefetcher->kind = kind;
+    prefetcher->degree = degree;
+    cache->prefetchLatency = latency;
+    if(kind != NOPREFETCH && cache->issued == NULL){
+        cache->issued = calloc((size_t)cache->sets * cache->ways, sizeof(unsigned long long));
+        if(cache->issued == NULL)
+            return -2;
+    }
+    return 0;
+}
+
+/**********************************************************************/
+/* Name:        prefetchLine                                          */
+/*                                                                    */
+/* Description: This function will fill a line into the cache if it   */
+/*              is not there, without touching the replacement state  */
+/*              of the lines already present                          */
+/*                                                                    */
+/* Inputs:      The prefetcher; the cache; the line number            */
+/*                                                                    */
+/* Outputs:     NONE                                                  */
+/**********************************************************************/
+void prefetchLine(struct prefetcher *prefetcher, struct cacheEngine *cache,
+                  unsigned long long line){
+
+    unsigned long long address = line << cache->offsetBits;
+    struct eviction evicted;
+    struct cache *entry;
+
+    if(cacheFind(cache, (unsigned int)line & cache->setMask, address) != NOENTRY)
+        return;
+    entry = cacheFill(cache, address, &evicted);
+    entry->prefetched = 1;
+    cache->issued[entry - cache->entries] = cache->demand;
+    cache->prefetches++;
+    cache->fillBytes += cache->lineSize;
+    if(evicted.valid){
+        unsigned long long victim = evicted.line.address >> cache->offsetBits;
+        prefetcher->polluted[victim & (POLLUTIONFILTER - 1)] = victim + 1;
+        if(evicted.line.dirty){
+            cache->writebacks++;
+            cache->writebackBytes += cache->lineSize;
+        }
+    }
+}
+
+/**********************************************************************/
+/* Name:        prefetchStride                                        */
+/*                                                                    */
+/* Description: This function will train the reference prediction     */
+/*              table with an access and prefetch along the stride of */
+/*              its page once the stride has repeated                 */
+/*                                                                    */
+/* Inputs:      The prefetcher; the cache; the line number            */
+/*                                                                    */
+/* Outputs:     NONE                                                  */
+/**********************************************************************/
+void prefetchStride(struct prefetcher *prefetcher, struct cacheEngine *cache,
+                    unsigned long long line){
+
+    unsigned long long page = (line << cache->offsetBits) >> RPTPAGEBITS;
+    struct rptEntry *entry = &prefetcher->table[page % RPTENTRIES];
+    long long stride = (long long)(line - entry->line);
+
+    if(!entry->valid || entry->page != page){
+        entry->valid = 1;
+        entry->page = page;
+        entry->line = line;
+        entry->stride = 0;
+        entry->confidence = 0;
+        return;
+    }
+    if(stride == 0)
+        return;
+    if(stride == entry->stride){
+        if(entry->confidence < RPTMAXCONFIDENCE)
+            entry->confidence++;
+    }
+    else if(entry->confidence > 0)
+        entry->confidence--;
+    else
+        entry->stride = stride;
+    entry->line = line;
+
+    if(entry->confidence >= RPTCONFIDENT)
+        for(unsigned int k = 1; k <= prefetcher->degree; k++)
+            prefetchLine(prefetcher, cache, line + (unsigned long long)(entry->stride * k));
+}
+
+/**********************************************************************/
+/* Name:        prefetchStream                                        */
+/*                                                                    */
+/* Description: This function will extend the stream a line continues */
+/*              and prefetch ahead of it, or start a new stream in    */
+/*              place of the least recently used one                  */
+/*                                                                    */
+/* Inputs:      The prefetcher; the cache; the line number            */
+/*                                                                    */
+/* Outputs:     NONE                                                  */
+/**********************************************************************/
+void prefetchStream(struct prefetcher *prefetcher, struct cacheEngine *cache,
+                    unsigned long long line){
+
+    struct stream *oldest = &prefetcher->streams[0];
+
+    for(int i = 0; i < STREAMS; i++){
+        struct stream *stream = &prefetcher->streams[i];
+        int direction;
+
+        if(!stream->valid){
+            oldest = stream;
+            continue;
+        }
+        if(oldest->valid && stream->used < oldest->used)
+            oldest = stream;
+        if(line == stream->line + 1)
+            direction = 1;
+        else if(line == stream->line - 1)
+            direction = -1;
+        else
+            continue;
+        if(stream->direction != 0 && direction != stream->direction)
+            continue;
+
+        stream->direction = direction;
+        stream->line = line;
+        stream->used = cache->timer;
+        for(unsigned int k = 1; k <= prefetcher->degree; k++)
+            prefetchLine(prefetcher, cache, line + (unsigned long long)((long long)direction * k));
+        return;
+    }
+
+    oldest->valid = 1;
+    oldest->line = line;
+    oldest->direction = 0;
+    oldest->used = cache->timer;
+}
+
+/**********************************************************************/
+/* Name:        prefetchReference                                     */
+/*                                                                    */
+/* Description: This function will simulate an access like            */
+/*              cacheReference and let the prefetcher see every line  */
+/*              it touches. The stride prefetcher learns from every   */
+/*              access; the others only from misses and from the      */
+/*              first use of prefetched lines, which would have been  */
+/*              misses without them                                   */
+/*                                                                    */
+/* Inputs:      The prefetcher; the cache; an address in decimal      */
+/*              format; the type of access; the number of bytes, 0    */
+/*              for one line                                          */
+/*                                                                    */
+/* Outputs:     NONE                                                  */
+/**********************************************************************/
+void prefetchReference(struct prefetcher *prefetcher, struct cacheEngine *cache,
+                       unsigned long long address, int type, unsigned int size){
+
+    unsigned int offset = address & (cache->lineSize - 1);
+
+    if(size == 0)
+        size = ACCESSSIZE < cache->lineSize - offset ? ACCESSSIZE : cache->lineSize - offset;
+    for(;;){
+        unsigned int part = size;
+        if(offset + part > cache->lineSize)
+            part = cache->lineSize - offset;
+
+        unsigned long long line = address >> cache->offsetBits;
+        unsigned long long used = cache->prefetchHits;
+        int hit = cacheReferenceLine(cache, address, type, part);
+
+        if(!hit){
+            unsigned long long *slot = &prefetcher->polluted[line & (POLLUTIONFILTER - 1)];
+            prefetcher->misses++;
+            if(*slot == line + 1){
+                prefetcher->pollution++;
+                *slot = 0;
+            }
+        }
+        switch(prefetcher->kind){
+          case NEXTLINE:
+              if(!hit || cache->prefetchHits != used)
+                  for(unsigned int k = 1; k <= prefetcher->degree; k++)
+                      prefetchLine(prefetcher, cache, line + k);
+              break;
+          case STRIDE:
+              prefetchStride(prefetcher, cache, line);
+              break;
+          case STREAM:
+              if(!hit || cache->prefetchHits != used)
+                  prefetchStream(prefetcher, cache, line);
+              break;
+          default :
+              break;
+        }
+
+        if(part == size)
+            break;
+        address += part;
+        size -= part;
+        offset = 0;
+    }
+}
+
+/**********************************************************************/
+/* Name:        prefetcherClearCounters                               */
+/*                                                                    */
+/* Description: This function will reset the counters of a prefetcher */
+/*              and keep what it has learnt                           */
+/*                                                                    */
+/* Inputs:      The prefetcher                                        */
+/*                                                                    */
+/* Outputs:     NONE                                                  */
+/**********************************************************************/
+void prefetcherClearCounters(struct prefetcher *prefetcher){
+    prefetcher->misses = 0;
+    prefetcher->pollution = 0;
+}
+
+/**********************************************************************/
+/* Name:        prefetcherStatistics                                  */
+/*                                                                    */
+/* Description: This function will print how many prefetches were     */
+/*              used (accuracy), how many of the misses they removed  */
+/*              (coverage), how many arrived in time (timeliness) and */
+/*              how many misses their evictions caused (pollution)    */
+/*                                                                    */
+/* Inputs:      The prefetcher; the cache                             */
+/*                                                                    */
+/* Outputs:     NONE                                                  */
+/**********************************************************************/
+void prefetcherStatistics(struct prefetcher *prefetcher, struct cacheEngine *cache){
+
+    unsigned long long useful = cache->prefetchHits;
+
+    printf("Prefetcher %s, degree %u: %llu lines prefetched, %llu used, %llu evicted unused\n",
+           prefetcherNames[prefetcher->kind], prefetcher->degree, cache->prefetches, useful,
+           cache->prefetchUnused);
+    printf("Accuracy %.6f, coverage %.6f, timeliness %.6f (%llu late, used within %u accesses), "
+           "pollution %.6f (%llu misses)\n\n",
+           cache->prefetches ? useful/(double)cache->prefetches : 0.0,
+           useful + prefetcher->misses ? useful/(double)(useful + prefetcher->misses) : 0.0,
+           useful ? (useful - cache->prefetchLate)/(double)useful : 0.0, cache->prefetchLate,
+           cache->prefetchLatency,
+           prefetcher->misses ? prefetcher->pollution/(double)prefetcher->misses : 0.0,
+           prefetcher->pollution);
+}
+
+#endif
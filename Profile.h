@@ -0,0 +1,370 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "CacheEngine.h"
+#include "CacheOutput.h"
+#include "Kernels.h"
+#include "Sampling.h"
+#include "StackDistance.h"
+
+/* Rows of the heat map of the sets and width of its bars */
+#define HEATROWS  16
+#define HEATWIDTH 40
+
+/* Share of the lines whose reuses and working set are followed by default */
+#define PROFILERATE 0.01
+
+/* Profile of a trace gathered while it is simulated: the reuse times and
+the LRU stack distances of the lines, binned by powers of two, the number
+of distinct lines in every window of accesses, and the accesses and the
+evictions of every set. Accesses are counted per line, so one that
+crosses lines counts in both. Only a hashed sample of the lines goes
+through the stack, as in SHARDS: their reuse times and distances, scaled
+by the rate, estimate the ones of the whole trace, and their number in a
+window the working set. The counts of the sets are exact */
+struct profile{
+    struct stackDistance stack;
+    int                failed;          /* 1 once the stack ran out of memory */
+    double             rate;            /* Share of the lines sampled */
+    unsigned int       threshold;       /* rate * 2^SAMPLEBITS */
+    unsigned long long events;          /* Line accesses, sampled or not */
+    unsigned long long times[LOGBINS];  /* Scaled reuse times, binned */
+
+    /* Working set over time */
+    unsigned long long window;          /* Line accesses per window */
+    unsigned long long windowStart;     /* First access of the window */
+    unsigned long long windowFirst;     /* First sampled access of the window */
+    unsigned long long windowLines;     /* Distinct sampled lines in the window */
+    unsigned long long *workingSet;     /* Lines of every finished window */
+    size_t             windows;
+    size_t             capacity;
+
+    /* Heat map */
+    unsigned long long *setAccesses;
+    unsigned long long *setEvictions;
+};
+
+/**********************************************************************/
+/* Name:        profileInit                                           */
+/*                                                                    */
+/* Description: This function will prepare the profile of the trace   */
+/*              of a cache                                            */
+/*                                                                    */
+/* Inputs:      The profile; the cache; the accesses of a window of   */
+/*              the working set; the share of the lines to sample, in */
+/*              (0, 1]                                                */
+/*                                                                    */
+/* Outputs:     0 on success, -1 if there is no memory                */
+/**********************************************************************/
+int profileInit(struct profile *profile, struct cacheEngine *cache, unsigned long long window,
+                double rate){
+
+    memset(profile, 0, sizeof(*profile));
+    if(stackInit(&profile->stack, cache->offsetBits) != 0)
+        return -1;
+    profile->rate = rate;
+    profile->threshold = (unsigned int)ceil(rate * (1u << SAMPLEBITS));
+    profile->window = window;
+    profile->setAccesses = calloc(cache->sets, sizeof(unsigned long long));
+    profile->setEvictions = calloc(cache->sets, sizeof(unsigned long long));
+    if(profile->setAccesses == NULL || profile->setEvictions == NULL){
+        free(profile->setAccesses);
+        free(profile->setEvictions);
+        stackFree(&profile->stack);
+        return -1;
+    }
+    return 0;
+}
+
+/**********************************************************************/
+/* Name:        profileFree                                           */
+/*                                                                    */
+/* Description: This function will release a profile                  */
+/*                                                                    */
+/* Inputs:      The profile                                           */
+/*                                                                    */
+/* Outputs:     NONE                                                  */
+/**********************************************************************/
+void profileFree(struct profile *profile){
+    stackFree(&profile->stack);
+    free(profile->workingSet);
+    free(profile->setAccesses);
+    free(profile->setEvictions);
+    memset(profile, 0, sizeof(*profile));
+}
+
+/**********************************************************************/
+/* Name:        profileLine                                           */
+/*                                                                    */
+/* Description: This function will add an access to the working set   */
+/*              of its window and, if its line is sampled, to the     */
+/*              stack distances                                       */
+/*                                                                    */
+/* Inputs:      The profile; an address in decimal format             */
+/*                                                                    */
+/* Outputs:     NONE                                                  */
+/**********************************************************************/
+void profileLine(struct profile *profile, unsigned long long address){
+
+    struct stackDistance *stack = &profile->stack;
+    unsigned int line = (unsigned int)(address >> stack->offsetBits);
+
+    if(profile->failed)
+        return;
+    profile->events++;
+    if((sampleHash(line) >> (32 - SAMPLEBITS)) < profile->threshold){
+        if(stackAccess(stack, (unsigned int)address) != 0){
+            profile->failed = 1;
+            return;
+        }
+
+        /* A line is new to the window if its previous access came before
+        it; a reuse time counts the sampled accesses in between */
+        if(stack->previous == NOPREVIOUS || stack->previous < profile->windowFirst)
+            profile->windowLines++;
+        if(stack->previous != NOPREVIOUS)
+            profile->times[logBin((unsigned long long)
+                                  ((stack->events - stack->previous - 2) / profile->rate))]++;
+    }
+    if(profile->events - profile->windowStart == profile->window){
+        if(profile->windows == profile->capacity){
+            size_t capacity = profile->capacity ? 2 * profile->capacity : 1024;
+            unsigned long long *grown = realloc(profile->workingSet,
+                                                capacity * sizeof(unsigned long long));
+            if(grown == NULL){
+                profile->failed = 1;
+                return;
+            }
+            profile->workingSet = grown;
+            profile->capacity = capacity;
+        }
+        profile->workingSet[profile->windows++] = profile->windowLines;
+        profile->windowStart = profile->events;
+        profile->windowFirst = stack->events;
+        profile->windowLines = 0;
+    }
+}
+
+/**********************************************************************/
+/* Name:        profileReference                                      */
+/*                                                                    */
+/* Description: This function will simulate an access like            */
+/*              cacheReference and profile every line it touches. A   */
+/*              miss in a full set evicts a line, except a write miss */
+/*              without write allocate                                */
+/*                                                                    */
+/* Inputs:      The profile; the cache; an address in decimal format; */
+/*              the type of access; the number of bytes, 0 for one    */
+/*              line                                                  */
+/*                                                                    */
+/* Outputs:     NONE                                                  */
+/**********************************************************************/
+void profileReference(struct profile *profile, struct cacheEngine *cache,
+                      unsigned long long address, int type, unsigned int size){
+
+    unsigned int offset = address & (cache->lineSize - 1);
+    int fills = type == READ || cache->allocate == WRITEALLOCATE;
+
+    if(size == 0)
+        size = ACCESSSIZE < cache->lineSize - offset ? ACCESSSIZE : cache->lineSize - offset;
+    for(;;){
+        unsigned int part = size;
+        if(offset + part > cache->lineSize)
+            part = cache->lineSize - offset;
+
+        unsigned int set = (unsigned int)(address >> cache->offsetBits) & cache->setMask;
+        int full = fills && cache->filled[set] == cache->ways;
+        profile->setAccesses[set]++;
+        if(!cacheReferenceLine(cache, address, type, part) && full)
+            profile->setEvictions[set]++;
+        profileLine(profile, address);
+
+        if(part == size)
+            break;
+        address += part;
+        size -= part;
+        offset = 0;
+    }
+}
+
+/**********************************************************************/
+/* Name:        profileReads                                          */
+/*                                                                    */
+/* Description: This function will simulate a batch of reads of       */
+/*              unknown size with the kernel of the cache and profile */
+/*              them. Every read touches a single line, which missed  */
+/*              if the hits did not grow                              */
+/*                                                                    */
+/* Inputs:      The profile; the cache; its kernel; the addresses;    */
+/*              their number                                          */
+/*                                                                    */
+/* Outputs:     NONE                                                  */
+/**********************************************************************/
+void profileReads(struct profile *profile, struct cacheEngine *cache, cacheKernel kernel,
+                  const unsigned int addresses[], size_t count){
+    for(size_t i = 0; i < count; i++){
+        unsigned int set = (addresses[i] >> cache->offsetBits) & cache->setMask;
+        int full = cache->filled[set] == cache->ways;
+        unsigned long long hits = cache->hits;
+
+        kernel(cache, &addresses[i], 1);
+        profile->setAccesses[set]++;
+        if(cache->hits == hits && full)
+            profile->setEvictions[set]++;
+        profileLine(profile, addresses[i]);
+    }
+}
+
+/**********************************************************************/
+/* Name:        binRange                                              */
+/*                                                                    */
+/* Description: This function will write the values of a power of two */
+/*              bin                                                   */
+/*                                                                    */
+/* Inputs:      The text; its size; the bin                           */
+/*                                                                    */
+/* Outputs:     NONE                                                  */
+/**********************************************************************/
+void binRange(char *text, size_t size, unsigned int bin){
+    if(bin <= 1)
+        snprintf(text, size, "%u", bin);
+    else if(bin == LOGBINS - 1)
+        snprintf(text, size, "%llu+", 1ull << (bin - 1));
+    else
+        snprintf(text, size, "%llu-%llu", 1ull << (bin - 1), (1ull << bin) - 1);
+}
+
+/**********************************************************************/
+/* Name:        profileStatistics                                     */
+/*                                                                    */
+/* Description: This function will print the histograms of the reuse  */
+/*              times and distances, the working set of every window  */
+/*              and the heat map of the sets, in a single write. The  */
+/*              counts of a sample are scaled to the whole trace      */
+/*                                                                    */
+/* Inputs:      The profile; the cache                                */
+/*                                                                    */
+/* Outputs:     NONE                                                  */
+/**********************************************************************/
+void profileStatistics(struct profile *profile, struct cacheEngine *cache){
+
+    struct stackDistance *stack = &profile->stack;
+    struct outputBuffer out = { NULL, 0, 0, 0 };
+    unsigned long long distances[LOGBINS] = { 0 };
+    unsigned long long reuses = stack->events - stack->cold;
+    double scale = 1.0 / profile->rate;
+    unsigned long long maxEvictions = 0, totalEvictions = 0;
+    unsigned int last = 0, hottest = 0;
+    unsigned int perRow = cache->sets < HEATROWS ? 1 : cache->sets / HEATROWS;
+    char range[48];
+
+    if(profile->failed)
+        outputPrintf(&out, "The profile ran out of memory and only covers the first %llu "
+                     "accesses\n\n", profile->events);
+
+    /* Reuse times and distances */
+    for(size_t d = 0; d < stack->histogramSize; d++)
+        distances[logBin((unsigned long long)(d * scale))] += stack->histogram[d];
+    for(unsigned int bin = 0; bin < LOGBINS; bin++)
+        if(profile->times[bin] != 0 || distances[bin] != 0)
+            last = bin;
+    outputPrintf(&out, "---------------------------------------------------------------------------------\n");
+    outputPrintf(&out, "|         RANGE         |   REUSE TIME   |  SHARE   | REUSE DISTANCE |  SHARE   |\n");
+    outputPrintf(&out, "---------------------------------------------------------------------------------\n");
+    for(unsigned int bin = 0; bin <= last && reuses != 0; bin++){
+        binRange(range, sizeof(range), bin);
+        outputPrintf(&out, "| %21s | %14.0f | %8.6f | %14.0f | %8.6f |\n", range,
+                     profile->times[bin] * scale, profile->times[bin]/(double)reuses,
+                     distances[bin] * scale, distances[bin]/(double)reuses);
+    }
+    outputPrintf(&out, "---------------------------------------------------------------------------------\n");
+    if(profile->rate < 1.0)
+        outputPrintf(&out, "%llu line accesses, about %.0f first accesses to %.0f distinct "
+                     "lines; sampled %g of the lines: %llu accesses\n\n", profile->events,
+                     stack->cold * scale, stack->distinct * scale, profile->rate, stack->events);
+    else
+        outputPrintf(&out, "%llu line accesses, %llu first accesses to %zu distinct lines\n\n",
+                     profile->events, stack->cold, stack->distinct);
+
+    /* Working set over time, the last window may be partial */
+    outputPrintf(&out, "----------------------------------------------------\n");
+    outputPrintf(&out, "|    WINDOW    |  DISTINCT LINES  |     BYTES      |\n");
+    outputPrintf(&out, "----------------------------------------------------\n");
+    for(size_t i = 0; i < profile->windows; i++)
+        outputPrintf(&out, "| %12zu | %16.0f | %14.0f |\n", i, profile->workingSet[i] * scale,
+                     profile->workingSet[i] * scale * cache->lineSize);
+    if(profile->events != profile->windowStart)
+        outputPrintf(&out, "| %11zu* | %16.0f | %14.0f |\n", profile->windows,
+                     profile->windowLines * scale, profile->windowLines * scale * cache->lineSize);
+    outputPrintf(&out, "----------------------------------------------------\n");
+    outputPrintf(&out, "Windows of %llu line accesses%s\n\n", profile->window,
+                 profile->events != profile->windowStart ? "; * marks a partial window" : "");
+
+    /* Heat map of the sets, in rows of consecutive sets */
+    for(unsigned int set = 0; set < cache->sets; set++){
+        totalEvictions += profile->setEvictions[set];
+        if(profile->setEvictions[set] > profile->setEvictions[hottest])
+            hottest = set;
+    }
+    unsigned long long rows[HEATROWS][2] = { { 0 } };
+    unsigned int count = cache->sets < HEATROWS ? cache->sets : HEATROWS;
+    for(unsigned int set = 0; set < cache->sets; set++){
+        rows[set / perRow][0] += profile->setAccesses[set];
+        rows[set / perRow][1] += profile->setEvictions[set];
+    }
+    for(unsigned int row = 0; row < count; row++)
+        if(rows[row][1] > maxEvictions)
+            maxEvictions = rows[row][1];
+    outputPrintf(&out, "----------------------------------------------------------------------------------------------------\n");
+    outputPrintf(&out, "%s %-*s |\n", "|         SETS        |    ACCESSES    |   EVICTIONS    |",
+                 HEATWIDTH, "EVICTION BAR");
+    outputPrintf(&out, "----------------------------------------------------------------------------------------------------\n");
+    for(unsigned int row = 0; row < count; row++){
+        int width = maxEvictions ? (int)(rows[row][1] * HEATWIDTH / maxEvictions) : 0;
+        snprintf(range, sizeof(range), "%u-%u", row * perRow, (row + 1) * perRow - 1);
+        outputPrintf(&out, "| %19s | %14llu | %14llu | %.*s%*s |\n", range, rows[row][0],
+                     rows[row][1], width, "########################################",
+                     HEATWIDTH - width, "");
+    }
+    outputPrintf(&out, "----------------------------------------------------------------------------------------------------\n");
+    outputPrintf(&out, "Set %u evicts the most lines, %llu, against %.1f per set on average\n\n",
+                 hottest, profile->setEvictions[hottest], totalEvictions/(double)cache->sets);
+    outputFlush(&out, stdout);
+}
+
+/**********************************************************************/
+/* Name:        profileWriteSets                                      */
+/*                                                                    */
+/* Description: This function will write the accesses and the         */
+/*              evictions of every set to a CSV file, which the heat  */
+/*              map only shows in bands                               */
+/*                                                                    */
+/* Inputs:      The profile; the cache; the name of the file          */
+/*                                                                    */
+/* Outputs:     0 on success, -1 on a write error or no memory        */
+/**********************************************************************/
+int profileWriteSets(struct profile *profile, struct cacheEngine *cache, const char *name){
+
+    struct outputBuffer out = { NULL, 0, 0, 0 };
+    FILE *fp;
+    int status;
+
+    outputPrintf(&out, "set,accesses,evictions\n");
+    for(unsigned int set = 0; set < cache->sets; set++)
+        outputPrintf(&out, "%u,%llu,%llu\n", set, profile->setAccesses[set],
+                     profile->setEvictions[set]);
+    if((fp = fopen(name, "w")) == NULL){
+        free(out.data);
+        return -1;
+    }
+    status = outputFlush(&out, fp);
+    if(fclose(fp) != 0)
+        status = -1;
+    return status;
+}
+
+#endif
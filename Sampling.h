@@ -0,0 +1,195 @@
+#ifndef SAMPLING_H
+#define SAMPLING_H
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "CacheEngine.h"
+
+/* Sampled lines or sets are the ones whose hash, out of 2^24, is below
+the rate times 2^24. The low bits of the hash spread the sampled accesses
+over groups whose hit rates give the confidence bounds */
+#define SAMPLEBITS   24
+#define SAMPLEGROUPS 64
+
+/* Approximate simulation of a sample of the trace. A cache with several
+sets only simulates the accesses to a hashed sample of its sets, which
+behave exactly as in the full cache; a fully associative cache keeps a
+hashed sample of the lines, as in SHARDS, in a cache with as many fewer
+ways as there are fewer lines. Either way the hit rate of the sample
+estimates the hit rate of the whole trace */
+struct sampler{
+    double             rate;        /* Fraction of the sets or lines kept */
+    unsigned int       threshold;   /* rate * 2^SAMPLEBITS */
+    int                bySet;       /* 1 to sample sets, 0 to sample lines */
+    unsigned long long events;      /* Line accesses seen, sampled or not */
+    unsigned long long sampled;
+    unsigned long long groupHits[SAMPLEGROUPS];
+    unsigned long long groupEvents[SAMPLEGROUPS];
+};
+
+/**********************************************************************/
+/* Name:        sampleHash                                            */
+/*                                                                    */
+/* Description: This function will mix the bits of a set or a line    */
+/*              so that strided addresses are sampled evenly          */
+/*                                                                    */
+/* Inputs:      The set or line                                       */
+/*                                                                    */
+/* Outputs:     The hash                                              */
+/**********************************************************************/
+unsigned int sampleHash(unsigned int value){
+    value ^= value >> 16;
+    value *= 0x7feb352du;
+    value ^= value >> 15;
+    value *= 0x846ca68bu;
+    return value ^ (value >> 16);
+}
+
+/**********************************************************************/
+/* Name:        samplerInit                                           */
+/*                                                                    */
+/* Description: This function will prepare the sampling of a cache    */
+/*              and the configuration of the cache to simulate: the   */
+/*              same one when sets are sampled, one with fewer ways   */
+/*              when lines are sampled                                */
+/*                                                                    */
+/* Inputs:      The sampler; the configuration of the full cache; the */
+/*              sampling rate, in (0, 1]; the configuration to        */
+/*              simulate                                              */
+/*                                                                    */
+/* Outputs:     0 on success, -1 on a bad rate                        */
+/**********************************************************************/
+int samplerInit(struct sampler *sampler, const struct cacheConfig *config, double rate,
+                struct cacheConfig *scaled){
+
+    memset(sampler, 0, sizeof(*sampler));
+    if(!(rate > 0.0 && rate <= 1.0))
+        return -1;
+    sampler->rate = rate;
+    sampler->threshold = (unsigned int)ceil(rate * (1u << SAMPLEBITS));
+    sampler->bySet = config->sets > 1;
+    *scaled = *config;
+
+    /* The sample of the lines needs a sample of the capacity; PLRU keeps
+    a power of two */
+    if(!sampler->bySet){
+        unsigned int ways = (unsigned int)(config->ways * rate + 0.5);
+        if(ways == 0)
+            ways = 1;
+        if(config->policy == PLRU)
+            while(ways & (ways - 1))
+                ways &= ways - 1;
+        scaled->ways = ways;
+    }
+    return 0;
+}
+
+/**********************************************************************/
+/* Name:        samplerReference                                      */
+/*                                                                    */
+/* Description: This function will simulate an access if its set or    */
+/*              line is in the sample and count it in its group; an   */
+/*              access that crosses lines is sampled line by line     */
+/*                                                                    */
+/* Inputs:      The sampler; the simulated cache; an address in       */
+/*              decimal format; the type of access; the number of     */
+/*              bytes, 0 for one line                                 */
+/*                                                                    */
+/* Outputs:     NONE                                                  */
+/**********************************************************************/
+void samplerReference(struct sampler *sampler, struct cacheEngine *cache,
+                      unsigned long long address, int type, unsigned int size){
+
+    unsigned int offset = address & (cache->lineSize - 1);
+
+    if(size == 0)
+        size = ACCESSSIZE < cache->lineSize - offset ? ACCESSSIZE : cache->lineSize - offset;
+    for(;;){
+        unsigned int part = size;
+        if(offset + part > cache->lineSize)
+            part = cache->lineSize - offset;
+
+        unsigned long long line = address >> cache->offsetBits;
+        unsigned int hash = sampleHash(sampler->bySet ? ((unsigned int)line & cache->setMask)
+                                                      : (unsigned int)(line ^ (line >> 32)));
+        sampler->events++;
+        if((hash >> (32 - SAMPLEBITS)) < sampler->threshold){
+            unsigned int group = hash & (SAMPLEGROUPS - 1);
+            sampler->sampled++;
+            sampler->groupEvents[group]++;
+            sampler->groupHits[group] += cacheReferenceLine(cache, address, type, part);
+        }
+
+        if(part == size)
+            break;
+        address += part;
+        size -= part;
+        offset = 0;
+    }
+}
+
+/**********************************************************************/
+/* Name:        samplerEstimate                                       */
+/*                                                                    */
+/* Description: This function will estimate the hit rate from the     */
+/*              sample with a 95% confidence interval, from the       */
+/*              spread of the hit rates of the groups                 */
+/*                                                                    */
+/* Inputs:      The sampler; the estimate, its lower and upper bounds */
+/*                                                                    */
+/* Outputs:     0 on success, -1 if no access was sampled             */
+/**********************************************************************/
+int samplerEstimate(struct sampler *sampler, double *estimate, double *lower, double *upper){
+
+    unsigned long long hits = 0;
+    double sum = 0.0, bound;
+    int groups = 0;
+
+    for(int i = 0; i < SAMPLEGROUPS; i++){
+        hits += sampler->groupHits[i];
+        groups += sampler->groupEvents[i] != 0;
+    }
+    if(sampler->sampled == 0)
+        return -1;
+    *estimate = hits/(double)sampler->sampled;
+
+    /* Variance of a ratio estimator over the groups */
+    for(int i = 0; i < SAMPLEGROUPS; i++){
+        double residual = sampler->groupHits[i] - *estimate * sampler->groupEvents[i];
+        sum += residual * residual;
+    }
+    bound = groups > 1 ? 1.96 * sqrt(groups / (groups - 1.0) * sum) / sampler->sampled : 1.0;
+    *lower = *estimate - bound < 0.0 ? 0.0 : *estimate - bound;
+    *upper = *estimate + bound > 1.0 ? 1.0 : *estimate + bound;
+    return 0;
+}
+
+/**********************************************************************/
+/* Name:        samplerStatistics                                     */
+/*                                                                    */
+/* Description: This function will print the hit rate estimated from   */
+/*              the sample with its 95% confidence interval, and the  */
+/*              misses of the whole trace it implies                  */
+/*                                                                    */
+/* Inputs:      The sampler                                           */
+/*                                                                    */
+/* Outputs:     NONE                                                  */
+/**********************************************************************/
+void samplerStatistics(struct sampler *sampler){
+
+    double estimate, lower, upper;
+
+    if(samplerEstimate(sampler, &estimate, &lower, &upper) != 0){
+        printf("No access was sampled at rate %g\n\n", sampler->rate);
+        return;
+    }
+    printf("Sampled %llu of %llu accesses (%s, rate %g)\n", sampler->sampled, sampler->events,
+           sampler->bySet ? "sets" : "lines", sampler->rate);
+    printf("Estimated hit rate %.6f, 95%% interval [%.6f, %.6f]\n", estimate, lower, upper);
+    printf("Estimated misses %.0f of %llu accesses\n\n", (1.0 - estimate) * sampler->events,
+           sampler->events);
+}
+
+#endif
@@ -0,0 +1,7 @@
+#define _DEFAULT_SOURCE
+
+#include "Simulator.h"
+
+int main(int argc, char *argv[]){
+    return runSimulator(argc, argv, "SET ASSOCIATIVE CACHE", SET_ASSOCIATIVE);
+}
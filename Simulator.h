@@ -0,0 +1,1181 @@
+#ifndef SIMULATOR_H
+#define SIMULATOR_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "CacheEngine.h"
+#include "CacheOutput.h"
+#include "Checkpoint.h"
+#include "Classification.h"
+#include "Kernels.h"
+#include "Partition.h"
+#include "Prefetch.h"
+#include "Profile.h"
+#include "Sampling.h"
+#include "StackDistance.h"
+#include "Tlb.h"
+#include "Trace.h"
+#include "TraceRing.h"
+
+#define TRACEBATCH 4096
+
+/* The organisations the front ends can simulate; they fix the ways or the
+sets of the cache and leave the rest of the geometry to the command line */
+enum organisation { DIRECT_MAPPED = 0, FULLY_ASSOCIATIVE, SET_ASSOCIATIVE };
+
+/* Regions with the most misses that are printed */
+#define TOPREGIONS 16
+
+/* Statistics of the accesses since the last report of a live run */
+struct window{
+    unsigned long long number;
+    unsigned long long accesses;    /* Trace accesses in the window */
+    unsigned long long hits;        /* Counters of the cache at its start */
+    unsigned long long events;
+    double             start;
+};
+
+/**********************************************************************/
+/* Name:        usage                                                 */
+/*                                                                    */
+/* Description: This function will print the command line options of  */
+/*              a front end                                           */
+/*                                                                    */
+/* Inputs:      The program name; the organisation of the cache       */
+/*                                                                    */
+/* Outputs:     NONE                                                  */
+/**********************************************************************/
+void usage(const char *program, int organisation){
+    fprintf(stderr, "usage: %s", program);
+    if(organisation != FULLY_ASSOCIATIVE)
+        fprintf(stderr, " [-s sets]");
+    if(organisation != DIRECT_MAPPED)
+        fprintf(stderr, " [-w ways]");
+    fprintf(stderr, " [-b line size] [-p fifo|lru|plru|rrip|random]"
+            " [-W writeback|writethrough] [-a allocate|noallocate]");
+    if(organisation == FULLY_ASSOCIATIVE)
+        fprintf(stderr, " [-c]");
+    fprintf(stderr, " [-r sampling rate] [-i accesses] [-t seconds] [-C] [-R region size]"
+            " [-m map file] [-f warmup accesses] [-K checkpoint] [-L checkpoint]"
+            " [-P none|nextline|stride|stream] [-d degree] [-l latency] [-o table|json|csv]"
+            " [-D dump file] [-H window] [-S profile rate] [-E set file] [-T tlb levels] [-G 4k|2m|1g|mixed] [-X cycles] [-V]");
+    if(organisation != FULLY_ASSOCIATIVE)
+        fprintf(stderr, " [-j threads]");
+    fprintf(stderr, " [trace file|-]\n");
+    fprintf(stderr, "  trace lines may start with R or W and end with a colon and the size of\n"
+            "  the access, e.g. W 3c5c:8\n");
+    fprintf(stderr, "  -i, -t  report every so many accesses or seconds; - reads standard input\n");
+    fprintf(stderr, "  -C  classify the misses as compulsory, capacity or conflict; -R size, a\n"
+            "      power of two from 2, or -m map file also attribute them to regions or to\n"
+            "      the ranges of the map, given as lines of hexadecimal start, end and name\n");
+    fprintf(stderr, "  -f  simulate so many accesses before counting; -K saves the cache then,\n"
+            "      or at the end without -f; -L continues from a saved cache and its\n"
+            "      place in the same trace. They do not combine with -c, -r or -C\n");
+    fprintf(stderr, "  -P  prefetch -d lines ahead (%d) into the cache; a prefetch used fewer than\n"
+            "      -l accesses (%d) after it was issued counts as late. Not with -c, -r,\n"
+            "      -C, -K or -L\n", PREFETCHDEGREE, PREFETCHLATENCY);
+    fprintf(stderr, "  -o  print the statistics as a table (%d entries at most), a JSON object or\n"
+            "      a CSV record; -D writes the valid lines to a binary file\n", TABLEENTRIES);
+    fprintf(stderr, "  -H  profile the reuse times and distances, the working set of every window\n"
+            "      of so many line accesses and the evictions of the sets. The first three\n"
+            "      follow a hashed sample of -S of the lines (%g), 1 for all of them; -E\n"
+            "      writes the accesses and evictions of every set as CSV. Not with -c,\n"
+            "      -r, -C, -P or -o\n", PROFILERATE);
+    fprintf(stderr, "  -T  translate through LRU TLB levels of entries[:ways], e.g. 64:4,1536:12,\n"
+            "      each holding that many pages of every size; -G maps the memory with\n"
+            "      pages of one size or a mix (4k); a walk reads 2 to 4 page table\n"
+            "      entries of -X cycles (%d), through the data cache with -V. Not with\n"
+            "      -c, -r, -C, -f, -K, -L, -P, -H, -j or -o\n", WALKCYCLES);
+    if(organisation == FULLY_ASSOCIATIVE)
+        fprintf(stderr, "  -c  print the LRU hit rate of every capacity in a single pass\n");
+    else
+        fprintf(stderr, "  -j  split the sets among so many threads, up to one per set, with the\n"
+                "      results of a single thread. Not with the random policy, -r, -i, -t,\n"
+                "      -C, -f, -K, -L, -P or -H\n");
+    fprintf(stderr, "  -r  only simulate a hashed sample of the %s, e.g. -r 0.01\n",
+            organisation == FULLY_ASSOCIATIVE ? "lines" : "sets");
+}
+
+/**********************************************************************/
+/* Name:        windowReport                                          */
+/*                                                                    */
+/* Description: This function will print the hits and misses of the   */
+/*              accesses since the last report and start a new window */
+/*                                                                    */
+/* Inputs:      The window; the cache                                 */
+/*                                                                    */
+/* Outputs:     NONE                                                  */
+/**********************************************************************/
+void windowReport(struct window *window, struct cacheEngine *cache){
+
+    unsigned long long hits = cache->hits - window->hits;
+    unsigned long long events = cache->events - window->events;
+
+    printf("window %llu: %llu accesses, %llu hits, %llu misses, hit rate %.6f (%.6f overall)\n",
+           window->number, window->accesses, hits, events - hits,
+           events ? hits/(double)events : 0.0,
+           cache->events ? cache->hits/(double)cache->events : 0.0);
+    fflush(stdout);
+
+    window->number++;
+    window->accesses = 0;
+    window->hits = cache->hits;
+    window->events = cache->events;
+    window->start = wallClock();
+}
+
+/**********************************************************************/
+/* Name:        runCurve                                              */
+/*                                                                    */
+/* Description: This function will compute the LRU stack distance of  */
+/*              every access of the trace and print the hit rate of   */
+/*              a fully associative LRU cache of every capacity. At a */
+/*              rate below 1 only a hashed sample of the lines is     */
+/*              followed, as in SHARDS                                */
+/*                                                                    */
+/* Inputs:      The trace; the line size; the sampling rate           */
+/*                                                                    */
+/* Outputs:     The exit status of the program                        */
+/**********************************************************************/
+int runCurve(struct trace *trace, unsigned int lineSize, double rate){
+
+    struct stackDistance stack;
+    unsigned int batch[TRACEBATCH];
+    unsigned int offsetBits = 0;
+    unsigned int threshold = (unsigned int)ceil(rate * (1u << SAMPLEBITS));
+    size_t       count;
+
+    while((1u << offsetBits) < lineSize)
+        offsetBits++;
+    if(stackInit(&stack, offsetBits) != 0)
+        return 1;
+
+    while((count = traceRead(trace, batch, TRACEBATCH)) > 0){
+        for(size_t i = 0; i < count; i++){
+            if((sampleHash(batch[i] >> offsetBits) >> (32 - SAMPLEBITS)) >= threshold)
+                continue;
+            if(stackAccess(&stack, batch[i]) != 0){
+                fprintf(stderr, "out of memory\n");
+                stackFree(&stack);
+                return 1;
+            }
+        }
+    }
+
+    stackCurve(&stack, lineSize, rate);
+    stackFree(&stack);
+    return 0;
+}
+
+/**********************************************************************/
+/* Name:        plainReads                                            */
+/*                                                                    */
+/* Description: This function will check that a piece of a batch only */
+/*              holds reads of unknown size, which a kernel can       */
+/*              simulate                                              */
+/*                                                                    */
+/* Inputs:      The types; the sizes; their number                    */
+/*                                                                    */
+/* Outputs:     1 if every access is a read of unknown size           */
+/**********************************************************************/
+int plainReads(const unsigned char types[], const unsigned char sizes[], size_t count){
+
+    unsigned char any = 0;
+
+    for(size_t i = 0; i < count; i++)
+        any |= types[i] | sizes[i];
+    return any == 0;
+}
+
+/* The options of a run, as given on the command line */
+struct runOptions{
+    struct cacheConfig config;
+    const char   *traceName;
+    int          curve;
+    double       rate;
+    unsigned long long interval;          /* Accesses per window, 0 for none */
+    double       period;                  /* Seconds per window, 0 for none */
+    int          classify;
+    unsigned long long regionSize;
+    const char   *mapName;
+    unsigned long long warmup;            /* Accesses simulated before counting */
+    const char   *saveName;               /* Checkpoint written after the warmup */
+    const char   *loadName;               /* Checkpoint to continue from */
+    int          prefetch;
+    unsigned int degree;
+    unsigned int latency;
+    int          format;
+    const char   *dumpName;               /* File for the valid lines */
+    unsigned long long profileWindow;     /* Accesses per working set window, 0 for no profile */
+    double       profileRate;             /* Share of the lines profiled, 0 if not given */
+    const char   *setsName;               /* CSV file for the counts of the sets */
+    unsigned int threads;                 /* Workers that share the sets */
+    const char   *tlbLevels;              /* Entries and ways of the TLB levels */
+    int          pageMapping;
+    unsigned int walkCycles;
+    int          walksToCache;
+};
+
+struct run;
+
+/* Simulates the accesses first to last - 1 of a block with the feature
+that drives the run */
+typedef void (*runStep)(struct run *run, const struct ringBlock *block, size_t first,
+                        size_t last);
+
+/* A run: its options, the cache and the state of every feature. The
+features that are not used stay zeroed, which their release functions
+accept */
+struct run{
+    struct runOptions  options;
+    const char         *program;
+    int                organisation;
+    struct cacheEngine cache;
+    struct trace       trace;
+    int                traceOpened;       /* 1 while the trace is open */
+    struct sampler     sampler;
+    struct classifier  classifier;
+    struct prefetcher  prefetcher;
+    struct profile     profile;
+    struct partition   partition;
+    struct tlb         tlb;
+    struct window      window;
+    cacheKernel        kernel;            /* Simulates the batches of plain reads */
+    runStep            step;
+    struct traceMark   mark;              /* Start of the current batch */
+    unsigned long long resume;            /* Addresses of the checkpoint */
+};
+
+/**********************************************************************/
+/* Name:        parseOptions                                          */
+/*                                                                    */
+/* Description: This function will read the options of a run from the */
+/*              command line                                          */
+/*                                                                    */
+/* Inputs:      The options; the command line                         */
+/*                                                                    */
+/* Outputs:     0 on success, -1 on an unknown or malformed option    */
+/**********************************************************************/
+int parseOptions(struct runOptions *options, int argc, char *argv[]){
+
+    struct cacheConfig config = { 16, 16, 1, FIFO, WRITEBACK, WRITEALLOCATE };
+    int  option;
+
+    memset(options, 0, sizeof(*options));
+    options->config = config;
+    options->traceName = "trace.txt";
+    options->rate = 1.0;
+    options->prefetch = NOPREFETCH;
+    options->degree = PREFETCHDEGREE;
+    options->latency = PREFETCHLATENCY;
+    options->format = TABLE;
+    options->threads = 1;
+    options->pageMapping = MAP4K;
+    options->walkCycles = WALKCYCLES;
+
+    while((option = getopt(argc, argv, "s:w:b:p:W:a:cr:i:t:CR:m:f:K:L:P:d:l:o:D:H:S:E:j:T:G:X:V")) != -1){
+        switch(option){
+          case 's':
+              options->config.sets = (unsigned int)strtoul(optarg, NULL, 0);
+              break;
+          case 'w':
+              options->config.ways = (unsigned int)strtoul(optarg, NULL, 0);
+              break;
+          case 'b':
+              options->config.lineSize = (unsigned int)strtoul(optarg, NULL, 0);
+              break;
+          case 'p':
+              options->config.policy = policyName(optarg);
+              break;
+          case 'W':
+              options->config.writePolicy = namedValue(optarg, writePolicyNames, 2);
+              break;
+          case 'a':
+              options->config.allocate = namedValue(optarg, allocatePolicyNames, 2);
+              break;
+          case 'c':
+              options->curve = 1;
+              break;
+          case 'r':
+              options->rate = strtod(optarg, NULL);
+              break;
+          case 'i':
+              options->interval = strtoull(optarg, NULL, 0);
+              break;
+          case 't':
+              options->period = strtod(optarg, NULL);
+              break;
+          case 'C':
+              options->classify = 1;
+              break;
+          case 'R':{
+              char *last;
+              options->regionSize = parseSize(optarg, &last);
+              if(*last != '\0' || options->regionSize < 2 ||
+                 (options->regionSize & (options->regionSize - 1)) != 0)
+                  return -1;
+              options->classify = 1;
+              break;
+          }
+          case 'm':
+              options->mapName = optarg;
+              options->classify = 1;
+              break;
+          case 'f':{
+              char *last;
+              options->warmup = strtoull(optarg, &last, 0);
+              if(*last != '\0')
+                  return -1;
+              break;
+          }
+          case 'K':
+              options->saveName = optarg;
+              break;
+          case 'L':
+              options->loadName = optarg;
+              break;
+          case 'P':
+              options->prefetch = namedValue(optarg, prefetcherNames, STREAM + 1);
+              break;
+          case 'd':
+              options->degree = (unsigned int)strtoul(optarg, NULL, 0);
+              break;
+          case 'l':
+              options->latency = (unsigned int)strtoul(optarg, NULL, 0);
+              break;
+          case 'o':
+              options->format = namedValue(optarg, outputFormatNames, CSV + 1);
+              break;
+          case 'D':
+              options->dumpName = optarg;
+              break;
+          case 'H':{
+              char *last;
+              options->profileWindow = parseSize(optarg, &last);
+              if(*last != '\0' || options->profileWindow == 0)
+                  return -1;
+              break;
+          }
+          case 'S':{
+              char *last;
+              options->profileRate = strtod(optarg, &last);
+              if(*last != '\0' || !(options->profileRate > 0.0 && options->profileRate <= 1.0))
+                  return -1;
+              break;
+          }
+          case 'E':
+              options->setsName = optarg;
+              break;
+          case 'j':
+              options->threads = (unsigned int)strtoul(optarg, NULL, 0);
+              break;
+          case 'T':
+              options->tlbLevels = optarg;
+              break;
+          case 'G':
+              options->pageMapping = namedValue(optarg, pageMappingNames, MAPMIXED + 1);
+              break;
+          case 'X':
+              options->walkCycles = (unsigned int)strtoul(optarg, NULL, 0);
+              break;
+          case 'V':
+              options->walksToCache = 1;
+              break;
+          default :
+              return -1;
+        }
+    }
+    if(optind < argc)
+        options->traceName = argv[optind];
+    return 0;
+}
+
+/**********************************************************************/
+/* Name:        checkCurve                                            */
+/*                                                                    */
+/* Description: This function will check that the curve of -c is only */
+/*              asked of a fully associative cache                    */
+/*                                                                    */
+/* Inputs:      The run, with its options parsed                      */
+/*                                                                    */
+/* Outputs:     1 if the options combine, 0 otherwise                 */
+/**********************************************************************/
+int checkCurve(const struct run *run){
+
+    const struct runOptions *options = &run->options;
+
+    return !options->curve || run->organisation == FULLY_ASSOCIATIVE;
+}
+
+/**********************************************************************/
+/* Name:        checkClassify                                         */
+/*                                                                    */
+/* Description: This function will check the options of the miss      */
+/*              classification, which needs every access of the trace */
+/*                                                                    */
+/* Inputs:      The run, with its options parsed                      */
+/*                                                                    */
+/* Outputs:     1 if the options combine, 0 otherwise                 */
+/**********************************************************************/
+int checkClassify(const struct run *run){
+
+    const struct runOptions *options = &run->options;
+
+    return !options->classify || (!options->curve && options->rate >= 1.0);
+}
+
+/**********************************************************************/
+/* Name:        checkWarmup                                           */
+/*                                                                    */
+/* Description: This function will check the options of the warmup    */
+/*              and the checkpoints, which only hold a plain cache    */
+/*                                                                    */
+/* Inputs:      The run, with its options parsed                      */
+/*                                                                    */
+/* Outputs:     1 if the options combine, 0 otherwise                 */
+/**********************************************************************/
+int checkWarmup(const struct run *run){
+
+    const struct runOptions *options = &run->options;
+
+    if(options->warmup == 0 && options->saveName == NULL && options->loadName == NULL)
+        return 1;
+    return !options->curve && !options->classify && options->rate >= 1.0;
+}
+
+/**********************************************************************/
+/* Name:        checkPrefetch                                         */
+/*                                                                    */
+/* Description: This function will check the options of the           */
+/*              prefetcher, whose streams a checkpoint does not keep  */
+/*                                                                    */
+/* Inputs:      The run, with its options parsed                      */
+/*                                                                    */
+/* Outputs:     1 if the options combine, 0 otherwise                 */
+/**********************************************************************/
+int checkPrefetch(const struct run *run){
+
+    const struct runOptions *options = &run->options;
+
+    if(options->prefetch == NOPREFETCH)
+        return 1;
+    return !options->curve && !options->classify && options->rate >= 1.0 &&
+           options->saveName == NULL && options->loadName == NULL;
+}
+
+/**********************************************************************/
+/* Name:        checkFormat                                           */
+/*                                                                    */
+/* Description: This function will check that a machine readable       */
+/*              record is only asked of a run that prints one table   */
+/*                                                                    */
+/* Inputs:      The run, with its options parsed                      */
+/*                                                                    */
+/* Outputs:     1 if the options combine, 0 otherwise                 */
+/**********************************************************************/
+int checkFormat(const struct run *run){
+
+    const struct runOptions *options = &run->options;
+
+    if(options->format < 0)
+        return 0;
+    return options->format == TABLE || (!options->curve && !options->classify &&
+                                        options->interval == 0 && options->period <= 0.0);
+}
+
+/**********************************************************************/
+/* Name:        checkProfile                                          */
+/*                                                                    */
+/* Description: This function will check the options of the profile,  */
+/*              which follows the accesses of a plain cache           */
+/*                                                                    */
+/* Inputs:      The run, with its options parsed                      */
+/*                                                                    */
+/* Outputs:     1 if the options combine, 0 otherwise                 */
+/**********************************************************************/
+int checkProfile(const struct run *run){
+
+    const struct runOptions *options = &run->options;
+
+    if(options->profileWindow == 0)
+        return options->profileRate == 0.0 && options->setsName == NULL;
+    return !options->curve && !options->classify && options->rate >= 1.0 &&
+           options->prefetch == NOPREFETCH && options->format == TABLE;
+}
+
+/**********************************************************************/
+/* Name:        checkThreads                                          */
+/*                                                                    */
+/* Description: This function will check the options of -j, whose      */
+/*              workers only simulate the sets of a plain cache and   */
+/*              report once at the end                                */
+/*                                                                    */
+/* Inputs:      The run, with its options parsed                      */
+/*                                                                    */
+/* Outputs:     1 if the options combine, 0 otherwise                 */
+/**********************************************************************/
+int checkThreads(const struct run *run){
+
+    const struct runOptions *options = &run->options;
+
+    if(options->threads == 0)
+        return 0;
+    if(options->threads == 1)
+        return 1;
+    return run->organisation != FULLY_ASSOCIATIVE && options->rate >= 1.0 &&
+           options->interval == 0 && options->period <= 0.0 && !options->classify &&
+           options->warmup == 0 && options->saveName == NULL && options->loadName == NULL &&
+           options->prefetch == NOPREFETCH && options->profileWindow == 0;
+}
+
+/**********************************************************************/
+/* Name:        checkTlb                                              */
+/*                                                                    */
+/* Description: This function will check the options of the TLB, which */
+/*              translates the accesses of a plain serial run         */
+/*                                                                    */
+/* Inputs:      The run, with its options parsed                      */
+/*                                                                    */
+/* Outputs:     1 if the options combine, 0 otherwise                 */
+/**********************************************************************/
+int checkTlb(const struct run *run){
+
+    const struct runOptions *options = &run->options;
+
+    if(options->tlbLevels == NULL)
+        return 1;
+    return !options->curve && options->rate >= 1.0 && !options->classify &&
+           options->warmup == 0 && options->saveName == NULL && options->loadName == NULL &&
+           options->prefetch == NOPREFETCH && options->profileWindow == 0 &&
+           options->threads == 1 && options->format == TABLE;
+}
+
+/* Every feature checks the options it does not combine with */
+int (*const optionChecks[])(const struct run *run) = {
+    checkCurve, checkClassify, checkWarmup, checkPrefetch, checkFormat, checkProfile,
+    checkThreads, checkTlb
+};
+
+/**********************************************************************/
+/* Name:        setupCache                                            */
+/*                                                                    */
+/* Description: This function will build the cache of a run, with the */
+/*              capacity of its sample, or load it from a checkpoint  */
+/*                                                                    */
+/* Inputs:      The run                                               */
+/*                                                                    */
+/* Outputs:     0 on success, -1 after printing the error             */
+/**********************************************************************/
+int setupCache(struct run *run){
+
+    struct runOptions *options = &run->options;
+    struct cacheConfig *config = &options->config;
+
+    /* A direct mapped cache has a single way and a fully associative cache
+    a single set */
+    if(run->organisation == DIRECT_MAPPED)
+        config->ways = 1;
+    else if(run->organisation == FULLY_ASSOCIATIVE)
+        config->sets = 1;
+
+    if(samplerInit(&run->sampler, config, options->rate, config) != 0){
+        fprintf(stderr, "%s: the sampling rate must be above 0 and at most 1\n", run->program);
+        return -1;
+    }
+    if(options->loadName != NULL){
+        int status = checkpointLoad(options->loadName, &run->cache, config, &run->mark,
+                                    &run->resume);
+        if(status != 0){
+            fprintf(stderr, status == -2 ? "%s: %s holds a cache of another configuration\n"
+                                         : "%s: cannot read %s\n", run->program,
+                    options->loadName);
+            return -1;
+        }
+    }
+    else if(cacheInit(&run->cache, config) != 0){
+        fprintf(stderr, "%s: invalid cache; sets, line size and the ways of plru "
+                "must be powers of two and the write policies known\n", run->program);
+        return -1;
+    }
+    run->kernel = kernelSelect(&run->cache);
+    return 0;
+}
+
+/**********************************************************************/
+/* Name:        setupTlb                                              */
+/*                                                                    */
+/* Description: This function will build the TLB levels of -T         */
+/*                                                                    */
+/* Inputs:      The run                                               */
+/*                                                                    */
+/* Outputs:     0 on success, -1 after printing the error             */
+/**********************************************************************/
+int setupTlb(struct run *run){
+
+    struct runOptions *options = &run->options;
+
+    if(options->tlbLevels != NULL &&
+       tlbInit(&run->tlb, options->tlbLevels, options->pageMapping, options->walkCycles,
+               options->walksToCache) != 0){
+        fprintf(stderr, "%s: invalid TLB; every level needs a power of two of sets and the "
+                "mapping must be 4k, 2m, 1g or mixed\n", run->program);
+        return -1;
+    }
+    return 0;
+}
+
+/**********************************************************************/
+/* Name:        setupThreads                                          */
+/*                                                                    */
+/* Description: This function will check that the cache can be split   */
+/*              among the workers of -j; they start with the trace    */
+/*                                                                    */
+/* Inputs:      The run                                               */
+/*                                                                    */
+/* Outputs:     0 on success, -1 after printing the error             */
+/**********************************************************************/
+int setupThreads(struct run *run){
+
+    unsigned int threads = run->options.threads;
+
+    if(threads > run->cache.sets || (threads > 1 && run->cache.policy == RANDOM)){
+        fprintf(stderr, "%s: -j needs a set per thread and a policy other than random\n",
+                run->program);
+        return -1;
+    }
+    return 0;
+}
+
+/**********************************************************************/
+/* Name:        setupPrefetch                                         */
+/*                                                                    */
+/* Description: This function will build the prefetcher of -P          */
+/*                                                                    */
+/* Inputs:      The run                                               */
+/*                                                                    */
+/* Outputs:     0 on success, -1 after printing the error             */
+/**********************************************************************/
+int setupPrefetch(struct run *run){
+
+    struct runOptions *options = &run->options;
+    int status = prefetcherInit(&run->prefetcher, &run->cache, options->prefetch, options->degree,
+                                options->latency);
+
+    if(status == -2){
+        fprintf(stderr, "%s: out of memory\n", run->program);
+        return -1;
+    }
+    if(status != 0){
+        fprintf(stderr, "%s: the prefetcher must be none, nextline, stride or stream and "
+                "fetch at least one line\n", run->program);
+        return -1;
+    }
+    return 0;
+}
+
+/**********************************************************************/
+/* Name:        setupClassify                                         */
+/*                                                                    */
+/* Description: This function will build the miss classifier of -C,    */
+/*              with the regions of -R or of the map of -m            */
+/*                                                                    */
+/* Inputs:      The run                                               */
+/*                                                                    */
+/* Outputs:     0 on success, -1 after printing the error             */
+/**********************************************************************/
+int setupClassify(struct run *run){
+
+    struct runOptions *options = &run->options;
+    unsigned int regionBits = 0;
+
+    if(!options->classify)
+        return 0;
+    while(options->regionSize > 1ull << regionBits)
+        regionBits++;
+    if(classifierInit(&run->classifier, &options->config, regionBits) != 0 ||
+       (options->mapName != NULL && loadRegions(&run->classifier, options->mapName) < 0)){
+        fprintf(stderr, "%s: cannot read %s\n", run->program,
+                options->mapName ? options->mapName : "memory");
+        return -1;
+    }
+    return 0;
+}
+
+/**********************************************************************/
+/* Name:        setupTrace                                            */
+/*                                                                    */
+/* Description: This function will open the trace, at the place of the */
+/*              checkpoint the run continues from                     */
+/*                                                                    */
+/* Inputs:      The run                                               */
+/*                                                                    */
+/* Outputs:     0 on success, -1 after printing the error             */
+/**********************************************************************/
+int setupTrace(struct run *run){
+
+    struct runOptions *options = &run->options;
+
+    if(traceOpen(&run->trace, options->traceName) != 0){
+        fprintf(stderr, "%s: cannot read %s\n", run->program, options->traceName);
+        return -1;
+    }
+    run->traceOpened = 1;
+    if(options->loadName != NULL && traceResume(&run->trace, &run->mark, run->resume) != 0){
+        fprintf(stderr, "%s: %s is shorter than the checkpoint\n", run->program,
+                options->traceName);
+        return -1;
+    }
+    return 0;
+}
+
+/**********************************************************************/
+/* Name:        setupProfile                                          */
+/*                                                                    */
+/* Description: This function will build the profile of -H             */
+/*                                                                    */
+/* Inputs:      The run                                               */
+/*                                                                    */
+/* Outputs:     0 on success, -1 after printing the error             */
+/**********************************************************************/
+int setupProfile(struct run *run){
+
+    double rate = run->options.profileRate != 0.0 ? run->options.profileRate : PROFILERATE;
+
+    if(run->options.profileWindow != 0 &&
+       profileInit(&run->profile, &run->cache, run->options.profileWindow, rate) != 0){
+        fprintf(stderr, "%s: out of memory\n", run->program);
+        return -1;
+    }
+    return 0;
+}
+
+/* The setup of every feature, in order */
+int (*const runSetups[])(struct run *run) = {
+    setupCache, setupTlb, setupThreads, setupPrefetch, setupClassify, setupTrace, setupProfile
+};
+
+/**********************************************************************/
+/* Name:        runClose                                              */
+/*                                                                    */
+/* Description: This function will close the trace of a run            */
+/*                                                                    */
+/* Inputs:      The run                                               */
+/*                                                                    */
+/* Outputs:     0 on success, -1 after printing the error if the      */
+/*              trace was truncated or corrupt                        */
+/**********************************************************************/
+int runClose(struct run *run){
+
+    if(!run->traceOpened)
+        return 0;
+    run->traceOpened = 0;
+    if(traceClose(&run->trace) != 0){
+        fprintf(stderr, "%s: %s is truncated or corrupt\n", run->program,
+                run->options.traceName);
+        return -1;
+    }
+    return 0;
+}
+
+/**********************************************************************/
+/* Name:        runFree                                               */
+/*                                                                    */
+/* Description: This function will release every feature of a run     */
+/*                                                                    */
+/* Inputs:      The run                                               */
+/*                                                                    */
+/* Outputs:     NONE                                                  */
+/**********************************************************************/
+void runFree(struct run *run){
+    if(run->traceOpened)
+        traceClose(&run->trace);
+    run->traceOpened = 0;
+    tlbFree(&run->tlb);
+    profileFree(&run->profile);
+    classifierFree(&run->classifier);
+    cacheFree(&run->cache);
+}
+
+/**********************************************************************/
+/* Name:        stepPartition                                         */
+/*                                                                    */
+/* Description: This function will route accesses to the workers of -j */
+/*                                                                    */
+/* Inputs:      The run; the block; the first and the end access      */
+/*                                                                    */
+/* Outputs:     NONE                                                  */
+/**********************************************************************/
+void stepPartition(struct run *run, const struct ringBlock *block, size_t first, size_t last){
+    for(size_t i = first; i < last; i++)
+        partitionReference(&run->partition, block->addresses[i], block->types[i],
+                           block->sizes[i]);
+}
+
+/**********************************************************************/
+/* Name:        stepClassify                                          */
+/*                                                                    */
+/* Description: This function will simulate and classify accesses     */
+/*                                                                    */
+/* Inputs:      The run; the block; the first and the end access      */
+/*                                                                    */
+/* Outputs:     NONE                                                  */
+/**********************************************************************/
+void stepClassify(struct run *run, const struct ringBlock *block, size_t first, size_t last){
+    if(plainReads(block->types + first, block->sizes + first, last - first)){
+        classifierReads(&run->classifier, &run->cache, run->kernel, block->addresses + first,
+                        last - first);
+        return;
+    }
+    for(size_t i = first; i < last; i++)
+        classifierReference(&run->classifier, &run->cache, block->addresses[i],
+                            block->types[i], block->sizes[i]);
+}
+
+/**********************************************************************/
+/* Name:        stepSample                                            */
+/*                                                                    */
+/* Description: This function will simulate the sampled accesses       */
+/*                                                                    */
+/* Inputs:      The run; the block; the first and the end access      */
+/*                                                                    */
+/* Outputs:     NONE                                                  */
+/**********************************************************************/
+void stepSample(struct run *run, const struct ringBlock *block, size_t first, size_t last){
+    for(size_t i = first; i < last; i++)
+        samplerReference(&run->sampler, &run->cache, block->addresses[i], block->types[i],
+                         block->sizes[i]);
+}
+
+/**********************************************************************/
+/* Name:        stepProfile                                           */
+/*                                                                    */
+/* Description: This function will simulate and profile accesses      */
+/*                                                                    */
+/* Inputs:      The run; the block; the first and the end access      */
+/*                                                                    */
+/* Outputs:     NONE                                                  */
+/**********************************************************************/
+void stepProfile(struct run *run, const struct ringBlock *block, size_t first, size_t last){
+    if(plainReads(block->types + first, block->sizes + first, last - first)){
+        profileReads(&run->profile, &run->cache, run->kernel, block->addresses + first,
+                     last - first);
+        return;
+    }
+    for(size_t i = first; i < last; i++)
+        profileReference(&run->profile, &run->cache, block->addresses[i], block->types[i],
+                         block->sizes[i]);
+}
+
+/**********************************************************************/
+/* Name:        stepPrefetch                                          */
+/*                                                                    */
+/* Description: This function will simulate accesses and the           */
+/*              prefetches they trigger                               */
+/*                                                                    */
+/* Inputs:      The run; the block; the first and the end access      */
+/*                                                                    */
+/* Outputs:     NONE                                                  */
+/**********************************************************************/
+void stepPrefetch(struct run *run, const struct ringBlock *block, size_t first, size_t last){
+    for(size_t i = first; i < last; i++)
+        prefetchReference(&run->prefetcher, &run->cache, block->addresses[i], block->types[i],
+                          block->sizes[i]);
+}
+
+/**********************************************************************/
+/* Name:        stepTlb                                               */
+/*                                                                    */
+/* Description: This function will translate and simulate accesses     */
+/*                                                                    */
+/* Inputs:      The run; the block; the first and the end access      */
+/*                                                                    */
+/* Outputs:     NONE                                                  */
+/**********************************************************************/
+void stepTlb(struct run *run, const struct ringBlock *block, size_t first, size_t last){
+    for(size_t i = first; i < last; i++)
+        tlbReference(&run->tlb, &run->cache, block->addresses[i], block->types[i],
+                     block->sizes[i]);
+}
+
+/**********************************************************************/
+/* Name:        stepCache                                             */
+/*                                                                    */
+/* Description: This function will simulate accesses in the cache     */
+/*              alone, with the kernel when they are all plain reads  */
+/*                                                                    */
+/* Inputs:      The run; the block; the first and the end access      */
+/*                                                                    */
+/* Outputs:     NONE                                                  */
+/**********************************************************************/
+void stepCache(struct run *run, const struct ringBlock *block, size_t first, size_t last){
+    if(plainReads(block->types + first, block->sizes + first, last - first)){
+        run->kernel(&run->cache, block->addresses + first, last - first);
+        return;
+    }
+    for(size_t i = first; i < last; i++)
+        cacheReference(&run->cache, block->addresses[i], block->types[i], block->sizes[i]);
+}
+
+/**********************************************************************/
+/* Name:        chooseStep                                            */
+/*                                                                    */
+/* Description: This function will return the step of the feature     */
+/*              that drives the accesses of a run after the warmup    */
+/*                                                                    */
+/* Inputs:      The options                                           */
+/*                                                                    */
+/* Outputs:     The step                                              */
+/**********************************************************************/
+runStep chooseStep(const struct runOptions *options){
+    if(options->threads > 1)
+        return stepPartition;
+    if(options->classify)
+        return stepClassify;
+    if(options->rate < 1.0)
+        return stepSample;
+    if(options->profileWindow != 0)
+        return stepProfile;
+    if(options->prefetch != NOPREFETCH)
+        return stepPrefetch;
+    if(options->tlbLevels != NULL)
+        return stepTlb;
+    return stepCache;
+}
+
+/**********************************************************************/
+/* Name:        warmupStep                                            */
+/*                                                                    */
+/* Description: This function will simulate accesses of the warmup,   */
+/*              which only fills the cache and the prefetcher, and    */
+/*              when it ends restart the counters and save the        */
+/*              checkpoint of -K                                      */
+/*                                                                    */
+/* Inputs:      The run; the block; the first and the end access      */
+/*                                                                    */
+/* Outputs:     NONE                                                  */
+/**********************************************************************/
+void warmupStep(struct run *run, const struct ringBlock *block, size_t first, size_t last){
+
+    struct runOptions *options = &run->options;
+
+    if(options->prefetch != NOPREFETCH)
+        stepPrefetch(run, block, first, last);
+    else
+        for(size_t i = first; i < last; i++)
+            cacheReference(&run->cache, block->addresses[i], block->types[i], block->sizes[i]);
+    options->warmup -= last - first;
+    if(options->warmup != 0)
+        return;
+
+    cacheClearCounters(&run->cache);
+    prefetcherClearCounters(&run->prefetcher);
+    if(options->saveName != NULL &&
+       checkpointSave(options->saveName, &run->cache, &run->mark, run->mark.accesses + last) != 0)
+        fprintf(stderr, "%s: cannot write %s\n", run->program, options->saveName);
+    options->saveName = NULL;
+    run->window.start = wallClock();
+}
+
+/**********************************************************************/
+/* Name:        simulate                                              */
+/*                                                                    */
+/* Description: This function will run the trace through the cache,    */
+/*              reading it on a thread of its own, and finish the     */
+/*              warmup, the windows and the checkpoint at its end     */
+/*                                                                    */
+/* Inputs:      The run                                               */
+/*                                                                    */
+/* Outputs:     0 on success, -1 after printing the error             */
+/**********************************************************************/
+int simulate(struct run *run){
+
+    struct runOptions *options = &run->options;
+    struct traceRing ring;                /* Blocks parsed by the producer thread */
+    const struct ringBlock *block;
+    size_t count;
+
+    if(options->threads > 1 &&
+       partitionInit(&run->partition, &run->cache, options->threads) != 0){
+        fprintf(stderr, "%s: cannot start %u threads\n", run->program, options->threads);
+        return -1;
+    }
+    if(ringOpen(&ring, &run->trace) != 0){
+        fprintf(stderr, "%s: cannot start the trace reader\n", run->program);
+        if(options->threads > 1)
+            partitionFinish(&run->partition);
+        return -1;
+    }
+
+    /* A batch is simulated in pieces that end on the windows and at the
+    end of the warmup, which only fills the cache: the counters restart
+    after it, and the checkpoint saved then resumes the rest of the run.
+    A window of -t also ends while the trace is idle */
+    run->step = chooseStep(options);
+    memset(&run->window, 0, sizeof(run->window));
+    run->window.start = wallClock();
+    for(;;){
+        double deadline = 0.0;
+        if(options->period > 0.0 && options->warmup == 0)
+            deadline = run->window.start + options->period;
+        if((block = ringNext(&ring, deadline)) == NULL){
+            windowReport(&run->window, &run->cache);
+            continue;
+        }
+        if((count = block->count) == 0)
+            break;
+        run->mark = block->mark;
+        for(size_t first = 0; first < count; ){
+            size_t last = count;
+            if(options->warmup != 0){
+                if(last - first > options->warmup)
+                    last = first + (size_t)options->warmup;
+                warmupStep(run, block, first, last);
+                first = last;
+                continue;
+            }
+            if(options->interval != 0 && last - first > options->interval - run->window.accesses)
+                last = first + (size_t)(options->interval - run->window.accesses);
+            run->step(run, block, first, last);
+            run->window.accesses += last - first;
+            first = last;
+            if(run->window.accesses == options->interval)
+                windowReport(&run->window, &run->cache);
+        }
+        if(options->period > 0.0 && options->warmup == 0 &&
+           wallClock() - run->window.start >= options->period)
+            windowReport(&run->window, &run->cache);
+        ringRelease(&ring);
+    }
+    run->mark = block->mark;
+    ringRelease(&ring);
+    ringClose(&ring);
+    if(options->threads > 1)
+        partitionFinish(&run->partition);
+    if(runClose(run) != 0)
+        return -1;
+
+    if((options->interval != 0 || options->period > 0.0) && run->window.accesses > 0)
+        windowReport(&run->window, &run->cache);
+    if(options->warmup != 0){
+        cacheClearCounters(&run->cache);
+        prefetcherClearCounters(&run->prefetcher);
+    }
+    if(options->saveName != NULL &&
+       checkpointSave(options->saveName, &run->cache, &run->mark, run->mark.accesses) != 0)
+        fprintf(stderr, "%s: cannot write %s\n", run->program, options->saveName);
+    if(options->dumpName != NULL && cacheDump(&run->cache, options->dumpName) != 0)
+        fprintf(stderr, "%s: cannot write %s\n", run->program, options->dumpName);
+    if(options->setsName != NULL &&
+       profileWriteSets(&run->profile, &run->cache, options->setsName) != 0)
+        fprintf(stderr, "%s: cannot write %s\n", run->program, options->setsName);
+    return 0;
+}
+
+/**********************************************************************/
+/* Name:        report                                                */
+/*                                                                    */
+/* Description: This function will print the results of a run: a      */
+/*              machine readable record, or the final state of the    */
+/*              cache and the statistics of every feature             */
+/*                                                                    */
+/* Inputs:      The run; the title of the table                       */
+/*                                                                    */
+/* Outputs:     NONE                                                  */
+/**********************************************************************/
+void report(struct run *run, const char *title){
+
+    struct runOptions *options = &run->options;
+    struct cacheEngine *cache = &run->cache;
+
+    /* A machine readable record replaces the text; a sampled run gives
+    its estimate, an exact one its hit rate */
+    if(options->format != TABLE){
+        double estimate[3];
+        estimate[0] = cache->events ? cache->hits/(double)cache->events : 0.0;
+        estimate[1] = estimate[2] = estimate[0];
+        if(options->rate < 1.0 &&
+           samplerEstimate(&run->sampler, &estimate[0], &estimate[1], &estimate[2]) != 0)
+            estimate[0] = estimate[1] = estimate[2] = 0.0;
+        printRecord(cache, options->format, title, estimate);
+        return;
+    }
+
+    /* Print the cache final state & information*/
+    printCache(cache, title);
+    double hitRate = cache->events ? cache->hits/(double)cache->events : 0.0;
+
+    /* Print the cache statistics*/
+    cacheStatistics(cache->hits, cache->events, hitRate);
+    printf("%llu reads, %llu writes (%llu write hits), %llu dirty lines written back\n",
+           cache->events - cache->writes, cache->writes, cache->writeHits, cache->writebacks);
+    printf("Bytes to the next level: %llu filled, %llu written back, %llu written through\n",
+           cache->fillBytes, cache->writebackBytes, cache->writeThroughBytes);
+    if(options->prefetch != NOPREFETCH)
+        prefetcherStatistics(&run->prefetcher, cache);
+    if(options->tlbLevels != NULL)
+        tlbStatistics(&run->tlb);
+    if(options->profileWindow != 0)
+        profileStatistics(&run->profile, cache);
+    if(options->rate < 1.0)
+        samplerStatistics(&run->sampler);
+    if(options->classify)
+        classifierStatistics(&run->classifier, TOPREGIONS);
+    printf("Trace parsed at %.1f MB/s\n", traceThroughput(&run->trace));
+}
+
+/**********************************************************************/
+/* Name:        runSimulator                                          */
+/*                                                                    */
+/* Description: This function will read the geometry of the cache     */
+/*              from the command line, run the trace through it and   */
+/*              print the final state of the cache and its statistics */
+/*                                                                    */
+/* Inputs:      The command line; the title of the table; the         */
+/*              organisation of the cache                             */
+/*                                                                    */
+/* Outputs:     The exit status of the program                        */
+/**********************************************************************/
+int runSimulator(int argc, char *argv[], const char *title, int organisation){
+
+    struct run run;
+    int status = 0;
+
+    memset(&run, 0, sizeof(run));
+    run.program = argv[0];
+    run.organisation = organisation;
+    if(parseOptions(&run.options, argc, argv) != 0){
+        usage(argv[0], organisation);
+        return 1;
+    }
+    for(size_t i = 0; i < sizeof(optionChecks) / sizeof(optionChecks[0]); i++)
+        if(!optionChecks[i](&run)){
+            usage(argv[0], organisation);
+            return 1;
+        }
+    for(size_t i = 0; i < sizeof(runSetups) / sizeof(runSetups[0]); i++)
+        if(runSetups[i](&run) != 0){
+            runFree(&run);
+            return 1;
+        }
+
+    /* The curve replaces one simulation per capacity */
+    if(run.options.curve){
+        status = runCurve(&run.trace, run.options.config.lineSize, run.options.rate);
+        if(runClose(&run) != 0)
+            status = 1;
+        runFree(&run);
+        return status;
+    }
+
+    if(simulate(&run) != 0)
+        status = 1;
+    else
+        report(&run, title);
+    runFree(&run);
+    return status;
+}
+
+#endif
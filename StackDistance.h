@@ -0,0 +1,418 @@
+#ifndef STACK_DISTANCE_H
+#define STACK_DISTANCE_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Initial number of time stamps of the Fenwick tree and buckets of the
+line index */
+#define STACKTIMES   (1u << 20)
+#define STACKBUCKETS (1u << 16)
+
+#define NOTIME 0xffffffffu
+
+/* Reuse times are counted in bins of powers of two: bin 0 holds 0 and bin
+k holds [2^(k-1), 2^k) */
+#define LOGBINS 65
+
+#define NOPREVIOUS 0xffffffffffffffffull
+
+/* LRU stack distances of a trace, computed with Mattson's algorithm in
+the form of Bennett and Kruskal: every line keeps a mark in a Fenwick tree
+at the time of its last access, so the number of distinct lines used since
+then is a prefix sum. An access hits in every LRU cache with more lines
+than its stack distance, so one pass gives the hits of every capacity */
+struct stackDistance{
+    unsigned int       offsetBits;  /* log2(line size) */
+
+    /* Index from a line to the time of its last access */
+    unsigned int       *lines;
+    unsigned int       *last;       /* NOTIME marks an empty bucket */
+    unsigned long long *seen;       /* Access number of the last access */
+    size_t             buckets;     /* A power of two */
+    size_t             distinct;    /* Lines in the index */
+
+    /* Fenwick tree with a 1 at the last access time of every line */
+    unsigned int       *tree;
+    size_t             times;       /* Time stamps in the tree */
+    size_t             now;         /* Next time stamp */
+
+    /* Number of accesses with every stack distance */
+    unsigned long long *histogram;
+    size_t             histogramSize;
+    unsigned long long events;
+    unsigned long long cold;        /* First accesses to a line */
+
+    /* Accesses between two accesses to the same line, binned with
+    logBin, and the number of the previous access to the line of the last
+    access, NOPREVIOUS for a first access */
+    unsigned long long timeHistogram[LOGBINS];
+    unsigned long long previous;
+};
+
+/**********************************************************************/
+/* Name:        logBin                                                */
+/*                                                                    */
+/* Description: This function will find the power of two bin of a      */
+/*              value                                                 */
+/*                                                                    */
+/* Inputs:      The value                                             */
+/*                                                                    */
+/* Outputs:     0 for 0, k for a value in [2^(k-1), 2^k)              */
+/**********************************************************************/
+unsigned int logBin(unsigned long long value){
+    unsigned int bin = 0;
+    while(value != 0){
+        bin++;
+        value >>= 1;
+    }
+    return bin;
+}
+
+/**********************************************************************/
+/* Name:        fenwickAdd                                            */
+/*                                                                    */
+/* Description: This function will add a value at a time stamp of     */
+/*              the Fenwick tree                                      */
+/*                                                                    */
+/* Inputs:      The stack distance state; the time; the value         */
+/*                                                                    */
+/* Outputs:     NONE                                                  */
+/**********************************************************************/
+void fenwickAdd(struct stackDistance *stack, size_t time, int value){
+    for(size_t i = time + 1; i <= stack->times; i += i & (0 - i))
+        stack->tree[i - 1] += (unsigned int)value;
+}
+
+/**********************************************************************/
+/* Name:        fenwickSum                                            */
+/*                                                                    */
+/* Description: This function will add the values of the time stamps   */
+/*              up to and including a given one                       */
+/*                                                                    */
+/* Inputs:      The stack distance state; the time                    */
+/*                                                                    */
+/* Outputs:     The sum                                               */
+/**********************************************************************/
+size_t fenwickSum(struct stackDistance *stack, size_t time){
+    size_t sum = 0;
+    for(size_t i = time + 1; i > 0; i -= i & (0 - i))
+        sum += stack->tree[i - 1];
+    return sum;
+}
+
+/**********************************************************************/
+/* Name:        stackInit                                             */
+/*                                                                    */
+/* Description: This function will prepare an empty stack distance     */
+/*              analysis for a line size                              */
+/*                                                                    */
+/* Inputs:      The stack distance state; log2 of the line size       */
+/*                                                                    */
+/* Outputs:     0 on success, -1 if there is no memory                */
+/**********************************************************************/
+int stackInit(struct stackDistance *stack, unsigned int offsetBits){
+
+    memset(stack, 0, sizeof(*stack));
+    stack->offsetBits = offsetBits;
+    stack->buckets = STACKBUCKETS;
+    stack->times = STACKTIMES;
+    stack->lines = malloc(stack->buckets * sizeof(unsigned int));
+    stack->last = malloc(stack->buckets * sizeof(unsigned int));
+    stack->seen = malloc(stack->buckets * sizeof(unsigned long long));
+    stack->tree = calloc(stack->times, sizeof(unsigned int));
+    if(stack->lines == NULL || stack->last == NULL || stack->seen == NULL || stack->tree == NULL){
+        free(stack->lines);
+        free(stack->last);
+        free(stack->seen);
+        free(stack->tree);
+        return -1;
+    }
+    memset(stack->last, 0xff, stack->buckets * sizeof(unsigned int));
+    return 0;
+}
+
+/**********************************************************************/
+/* Name:        stackFree                                             */
+/*                                                                    */
+/* Description: This function will release a stack distance analysis  */
+/*                                                                    */
+/* Inputs:      The stack distance state                              */
+/*                                                                    */
+/* Outputs:     NONE                                                  */
+/**********************************************************************/
+void stackFree(struct stackDistance *stack){
+    free(stack->lines);
+    free(stack->last);
+    free(stack->seen);
+    free(stack->tree);
+    free(stack->histogram);
+    memset(stack, 0, sizeof(*stack));
+}
+
+/**********************************************************************/
+/* Name:        stackBucket                                           */
+/*                                                                    */
+/* Description: This function will find the bucket of a line in the   */
+/*              line index, or the empty bucket where it would go     */
+/*                                                                    */
+/* Inputs:      The stack distance state; the line                    */
+/*                                                                    */
+/* Outputs:     The bucket                                            */
+/**********************************************************************/
+size_t stackBucket(struct stackDistance *stack, unsigned int line){
+
+    /* Fold the high bits of the product in, so lines with a common
+    stride do not share their low bits */
+    size_t mask = stack->buckets - 1;
+    unsigned int hash = line * 2654435769u;
+    size_t i = (hash ^ (hash >> 16)) & mask;
+    while(stack->last[i] != NOTIME && stack->lines[i] != line)
+        i = (i + 1) & mask;
+    return i;
+}
+
+/**********************************************************************/
+/* Name:        stackGrowIndex                                        */
+/*                                                                    */
+/* Description: This function will double the buckets of the line     */
+/*              index                                                 */
+/*                                                                    */
+/* Inputs:      The stack distance state                              */
+/*                                                                    */
+/* Outputs:     0 on success, -1 if there is no memory                */
+/**********************************************************************/
+int stackGrowIndex(struct stackDistance *stack){
+
+    unsigned int *lines = stack->lines;
+    unsigned int *last = stack->last;
+    unsigned long long *seen = stack->seen;
+    size_t buckets = stack->buckets;
+
+    stack->buckets = 2 * buckets;
+    stack->lines = malloc(stack->buckets * sizeof(unsigned int));
+    stack->last = malloc(stack->buckets * sizeof(unsigned int));
+    stack->seen = malloc(stack->buckets * sizeof(unsigned long long));
+    if(stack->lines == NULL || stack->last == NULL || stack->seen == NULL){
+        free(stack->lines);
+        free(stack->last);
+        free(stack->seen);
+        stack->lines = lines;
+        stack->last = last;
+        stack->seen = seen;
+        stack->buckets = buckets;
+        return -1;
+    }
+    memset(stack->last, 0xff, stack->buckets * sizeof(unsigned int));
+
+    for(size_t i = 0; i < buckets; i++){
+        if(last[i] != NOTIME){
+            size_t j = stackBucket(stack, lines[i]);
+            stack->lines[j] = lines[i];
+            stack->last[j] = last[i];
+            stack->seen[j] = seen[i];
+        }
+    }
+    free(lines);
+    free(last);
+    free(seen);
+    return 0;
+}
+
+/**********************************************************************/
+/* Name:        compareTimes                                          */
+/*                                                                    */
+/* Description: This function will order two buckets of the line index */
+/*              by the time of their last access, for qsort           */
+/*                                                                    */
+/* Inputs:      Two pointers to the times of the buckets              */
+/*                                                                    */
+/* Outputs:     Negative, zero or positive                            */
+/**********************************************************************/
+int compareTimes(const void *a, const void *b){
+    unsigned int x = **(unsigned int * const *)a;
+    unsigned int y = **(unsigned int * const *)b;
+    return (x > y) - (x < y);
+}
+
+/**********************************************************************/
+/* Name:        stackCompact                                          */
+/*                                                                    */
+/* Description: This function will renumber the last access times of  */
+/*              the lines from 0 when the Fenwick tree runs out of    */
+/*              time stamps, keeping their order, so the tree only    */
+/*              grows with the number of distinct lines and not with  */
+/*              the length of the trace                               */
+/*                                                                    */
+/* Inputs:      The stack distance state                              */
+/*                                                                    */
+/* Outputs:     0 on success, -1 if there is no memory                */
+/**********************************************************************/
+int stackCompact(struct stackDistance *stack){
+
+    unsigned int **order = malloc(stack->distinct * sizeof(unsigned int *));
+    size_t n = 0;
+
+    if(order == NULL)
+        return -1;
+    for(size_t i = 0; i < stack->buckets; i++)
+        if(stack->last[i] != NOTIME)
+            order[n++] = &stack->last[i];
+    qsort(order, n, sizeof(unsigned int *), compareTimes);
+
+    /* Keep at least half of the tree free for new time stamps */
+    if(2 * n > stack->times){
+        unsigned int *tree = realloc(stack->tree, 4 * n * sizeof(unsigned int));
+        if(tree == NULL){
+            free(order);
+            return -1;
+        }
+        stack->tree = tree;
+        stack->times = 4 * n;
+    }
+
+    /* The first n time stamps are the lines; build the tree in place */
+    for(size_t i = 0; i < n; i++)
+        *order[i] = (unsigned int)i;
+    for(size_t i = 1; i <= stack->times; i++)
+        stack->tree[i - 1] = (i <= n) ? 1 : 0;
+    for(size_t i = 1; i <= stack->times; i++){
+        size_t parent = i + (i & (0 - i));
+        if(parent <= stack->times)
+            stack->tree[parent - 1] += stack->tree[i - 1];
+    }
+
+    stack->now = n;
+    free(order);
+    return 0;
+}
+
+/**********************************************************************/
+/* Name:        stackAccess                                           */
+/*                                                                    */
+/* Description: This function will record the stack distance of an    */
+/*              access: the number of other lines used since the      */
+/*              last access to its line, and its reuse time: the      */
+/*              number of accesses in between                         */
+/*                                                                    */
+/* Inputs:      The stack distance state; an address                  */
+/*                                                                    */
+/* Outputs:     0 on success, -1 if there is no memory                */
+/**********************************************************************/
+int stackAccess(struct stackDistance *stack, unsigned int address){
+
+    unsigned int line = address >> stack->offsetBits;
+
+    if(stack->now == stack->times && stackCompact(stack) != 0)
+        return -1;
+    if(2 * (stack->distinct + 1) > stack->buckets && stackGrowIndex(stack) != 0)
+        return -1;
+
+    size_t i = stackBucket(stack, line);
+
+    if(stack->last[i] == NOTIME){
+        stack->lines[i] = line;
+        stack->distinct++;
+        stack->cold++;
+        stack->previous = NOPREVIOUS;
+    }
+    else{
+        /* Every line has one mark, so the marks after the last access of
+        this line are the lines used since */
+        size_t distance = stack->distinct - fenwickSum(stack, stack->last[i]);
+
+        if(distance >= stack->histogramSize){
+            size_t size = stack->histogramSize ? stack->histogramSize : 1024;
+            while(size <= distance)
+                size *= 2;
+            unsigned long long *histogram = realloc(stack->histogram, size * sizeof(unsigned long long));
+            if(histogram == NULL)
+                return -1;
+            memset(histogram + stack->histogramSize, 0,
+                   (size - stack->histogramSize) * sizeof(unsigned long long));
+            stack->histogram = histogram;
+            stack->histogramSize = size;
+        }
+        stack->histogram[distance]++;
+        stack->previous = stack->seen[i];
+        stack->timeHistogram[logBin(stack->events - stack->previous - 1)]++;
+        fenwickAdd(stack, stack->last[i], -1);
+    }
+
+    stack->seen[i] = stack->events++;
+    stack->last[i] = (unsigned int)stack->now;
+    fenwickAdd(stack, stack->now, 1);
+    stack->now++;
+    return 0;
+}
+
+/**********************************************************************/
+/* Name:        stackCurve                                            */
+/*                                                                    */
+/* Description: This function will print the hits and the hit rate of  */
+/*              a fully associative LRU cache at every capacity where */
+/*              they change, one line above every stack distance      */
+/*              seen, and then a summary at every power of two        */
+/*              capacity up to the number of distinct lines. When     */
+/*              only a sample of the lines was followed, a capacity   */
+/*              holds rate times as many of them and the counts are   */
+/*              scaled back to the whole trace                        */
+/*                                                                    */
+/* Inputs:      The stack distance state; the line size; the sampling */
+/*              rate, 1 for the exact curve                           */
+/*                                                                    */
+/* Outputs:     NONE                                                  */
+/**********************************************************************/
+void stackCurve(struct stackDistance *stack, unsigned int lineSize, double rate){
+
+    unsigned long long hits = 0;
+    size_t distance = 0;
+    size_t capacity = 1;
+
+    /* The accesses with a distance hit from the smallest capacity that
+    holds distance + 1 sampled lines */
+    printf("Every capacity where the hit rate changes:\n");
+    printf("-----------------------------------------------------------\n");
+    printf("|     LINES    |      BYTES     |      HITS     | HIT RATE |\n");
+    printf("-----------------------------------------------------------\n");
+    for(distance = 0; distance < stack->histogramSize; distance++){
+        if(stack->histogram[distance] == 0)
+            continue;
+        hits += stack->histogram[distance];
+        capacity = (size_t)(distance / rate) + 1;
+        printf("| %12zu | %14llu | %13.0f | %.6f |\n", capacity,
+               (unsigned long long)capacity * lineSize, hits / rate,
+               stack->events ? hits/(double)stack->events : 0.0);
+    }
+    printf("-----------------------------------------------------------\n\n");
+
+    hits = 0;
+    distance = 0;
+    capacity = 1;
+    printf("Power of two capacities:\n");
+    printf("-----------------------------------------------------------\n");
+    printf("|     LINES    |      BYTES     |      HITS     | HIT RATE |\n");
+    printf("-----------------------------------------------------------\n");
+    for(;;){
+        /* Accesses with a distance below the capacity hit */
+        while(distance < capacity * rate && distance < stack->histogramSize)
+            hits += stack->histogram[distance++];
+        printf("| %12zu | %14llu | %13.0f | %.6f |\n", capacity,
+               (unsigned long long)capacity * lineSize, hits / rate,
+               stack->events ? hits/(double)stack->events : 0.0);
+        if(capacity * rate >= stack->distinct)
+            break;
+        capacity *= 2;
+    }
+    printf("-----------------------------------------------------------\n");
+    if(rate < 1.0)
+        printf("Sampled %g of the lines: %llu accesses, %zu distinct lines, %llu cold misses; "
+               "about %.0f, %.0f and %.0f in the trace\n\n", rate, stack->events, stack->distinct,
+               stack->cold, stack->events / rate, stack->distinct / rate, stack->cold / rate);
+    else
+        printf("%llu accesses, %zu distinct lines, %llu cold misses\n\n",
+               stack->events, stack->distinct, stack->cold);
+}
+
+#endif
@@ -0,0 +1,255 @@
+#ifndef TLB_H
+#define TLB_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "CacheEngine.h"
+
+/* Levels of TLB that can be stacked in front of the data cache */
+#define TLBLEVELS 3
+
+/* Page sizes; a level of TLB keeps every size in its own array of the
+same geometry, as an engine whose lines are the pages */
+enum pageKind { PAGE4K = 0, PAGE2M, PAGE1G, PAGEKINDS };
+
+/* How the stand-in operating system backs the memory: with pages of one
+size, or with a mix where a hashed eighth of the 1 GB regions are 1 GB
+pages and a hashed half of the other 2 MB regions are 2 MB pages */
+enum pageMapping { MAP4K = 0, MAP2M, MAP1G, MAPMIXED };
+
+const char *pageMappingNames[] = { "4k", "2m", "1g", "mixed" };
+
+const unsigned int pageBits[PAGEKINDS] = { 12, 21, 30 };
+
+/* Entries of the four level page table a walk reads for every page size */
+const unsigned int walkLevels[PAGEKINDS] = { 4, 3, 2 };
+
+/* The page tables live above the 4 GB of the traces, one region per level
+of the table, with an entry of PTEBYTES per page or table it maps; the
+memory is mapped one to one */
+#define PAGETABLES 0x100000000ull
+#define TABLESPAN  (1ull << 40)
+#define PTEBYTES   8
+
+/* Cycles of every read of a walk */
+#define WALKCYCLES 30
+
+struct tlb{
+    unsigned int       count;               /* Levels, 0 without a TLB */
+    struct cacheEngine levels[TLBLEVELS][PAGEKINDS];
+    int                mapping;
+    unsigned int       walkCycles;          /* Cycles per page table read */
+    int                walksToCache;        /* 1 if the walks read through the data cache */
+
+    unsigned long long translations;
+    unsigned long long walks[PAGEKINDS];
+    unsigned long long walkReads;           /* Page table entries read */
+    unsigned long long walkHits;            /* Of them, hits in the data cache */
+};
+
+/**********************************************************************/
+/* Name:        tlbFree                                               */
+/*                                                                    */
+/* Description: This function will release the levels of a TLB         */
+/*                                                                    */
+/* Inputs:      The TLB                                               */
+/*                                                                    */
+/* Outputs:     NONE                                                  */
+/**********************************************************************/
+void tlbFree(struct tlb *tlb){
+    for(unsigned int level = 0; level < tlb->count; level++)
+        for(int kind = 0; kind < PAGEKINDS; kind++)
+            cacheFree(&tlb->levels[level][kind]);
+    memset(tlb, 0, sizeof(*tlb));
+}
+
+/**********************************************************************/
+/* Name:        tlbInit                                               */
+/*                                                                    */
+/* Description: This function will build the levels of a TLB from a    */
+/*              list of entries and ways such as 64:4,1536:12; a      */
+/*              level without ways is fully associative. Every level  */
+/*              is LRU                                                */
+/*                                                                    */
+/* Inputs:      The TLB; the list of levels; the page mapping; the    */
+/*              cycles of a page table read; 1 to read the page       */
+/*              tables through the data cache                         */
+/*                                                                    */
+/* Outputs:     0 on success, -1 on a bad list or no memory           */
+/**********************************************************************/
+int tlbInit(struct tlb *tlb, const char *levels, int mapping, unsigned int walkCycles,
+            int walksToCache){
+
+    const char *p = levels;
+
+    memset(tlb, 0, sizeof(*tlb));
+    if(mapping < MAP4K || mapping > MAPMIXED)
+        return -1;
+    tlb->mapping = mapping;
+    tlb->walkCycles = walkCycles;
+    tlb->walksToCache = walksToCache;
+
+    while(tlb->count < TLBLEVELS){
+        char *end;
+        unsigned long entries = strtoul(p, &end, 0);
+        unsigned long ways = entries;
+        if(*end == ':')
+            ways = strtoul(end + 1, &end, 0);
+        if(entries == 0 || ways == 0 || entries % ways != 0 || (*end != ',' && *end != '\0'))
+            break;
+
+        struct cacheConfig config = { (unsigned int)(entries / ways), (unsigned int)ways, 0,
+                                      LRU, WRITEBACK, WRITEALLOCATE };
+        int kind;
+        for(kind = 0; kind < PAGEKINDS; kind++){
+            config.lineSize = 1u << pageBits[kind];
+            if(cacheInit(&tlb->levels[tlb->count][kind], &config) != 0)
+                break;
+        }
+        if(kind < PAGEKINDS){
+            while(kind-- > 0)
+                cacheFree(&tlb->levels[tlb->count][kind]);
+            break;
+        }
+        tlb->count++;
+        if(*end == '\0')
+            return 0;
+        p = end + 1;
+    }
+    tlbFree(tlb);
+    return -1;
+}
+
+/**********************************************************************/
+/* Name:        pageKind                                              */
+/*                                                                    */
+/* Description: This function will return the size of the page that   */
+/*              maps an address                                       */
+/*                                                                    */
+/* Inputs:      The TLB; an address in decimal format                 */
+/*                                                                    */
+/* Outputs:     The kind of page                                      */
+/**********************************************************************/
+int pageKind(struct tlb *tlb, unsigned long long address){
+
+    switch(tlb->mapping){
+      case MAP2M:
+          return PAGE2M;
+      case MAP1G:
+          return PAGE1G;
+      case MAPMIXED:
+          /* Fibonacci hashing of the region, counted from 1 so that the
+          first one is not always a huge page */
+          if((((address >> pageBits[PAGE1G]) + 1) * 0x9e3779b97f4a7c15ull) >> 61 == 0)
+              return PAGE1G;
+          if((((address >> pageBits[PAGE2M]) + 1) * 0x9e3779b97f4a7c15ull) >> 63 == 0)
+              return PAGE2M;
+          return PAGE4K;
+      default :
+          return PAGE4K;
+    }
+}
+
+/**********************************************************************/
+/* Name:        tlbTranslate                                          */
+/*                                                                    */
+/* Description: This function will look the page of an address up in  */
+/*              the levels of the TLB, filling the levels that miss,  */
+/*              and walk the page table when all of them miss         */
+/*                                                                    */
+/* Inputs:      The TLB; the data cache; an address in decimal format */
+/*                                                                    */
+/* Outputs:     NONE                                                  */
+/**********************************************************************/
+void tlbTranslate(struct tlb *tlb, struct cacheEngine *cache, unsigned long long address){
+
+    int kind = pageKind(tlb, address);
+
+    tlb->translations++;
+    for(unsigned int level = 0; level < tlb->count; level++)
+        if(cacheReferenceLine(&tlb->levels[level][kind], address, READ, 1))
+            return;
+
+    /* The walk reads one entry per level of the table, from the root */
+    tlb->walks[kind]++;
+    for(unsigned int step = 0; step < walkLevels[kind]; step++){
+        unsigned long long entry = PAGETABLES + step * TABLESPAN +
+                                   (address >> (39 - 9 * step)) * PTEBYTES;
+        tlb->walkReads++;
+        if(tlb->walksToCache){
+            /* A read of several lines only hits if all of them do */
+            unsigned long long misses = cache->events - cache->hits;
+            cacheReference(cache, entry, READ, PTEBYTES);
+            tlb->walkHits += cache->events - cache->hits == misses;
+        }
+    }
+}
+
+/**********************************************************************/
+/* Name:        tlbReference                                          */
+/*                                                                    */
+/* Description: This function will translate an access, once per page */
+/*              it touches, and simulate it in the data cache         */
+/*                                                                    */
+/* Inputs:      The TLB; the data cache; an address in decimal        */
+/*              format; the type of access; the number of bytes, 0    */
+/*              for one line                                          */
+/*                                                                    */
+/* Outputs:     NONE                                                  */
+/**********************************************************************/
+void tlbReference(struct tlb *tlb, struct cacheEngine *cache, unsigned long long address,
+                  int type, unsigned int size){
+
+    unsigned long long last = address + (size ? size : 1) - 1;
+    int kind = pageKind(tlb, address);
+
+    tlbTranslate(tlb, cache, address);
+    if(pageKind(tlb, last) != kind || last >> pageBits[kind] != address >> pageBits[kind])
+        tlbTranslate(tlb, cache, last);
+    cacheReference(cache, address, type, size);
+}
+
+/**********************************************************************/
+/* Name:        tlbStatistics                                         */
+/*                                                                    */
+/* Description: This function will print the hit rate of every level   */
+/*              of the TLB, the page walks and the cycles they cost   */
+/*                                                                    */
+/* Inputs:      The TLB                                               */
+/*                                                                    */
+/* Outputs:     NONE                                                  */
+/**********************************************************************/
+void tlbStatistics(struct tlb *tlb){
+
+    unsigned long long walks = 0;
+
+    printf("-----------------------------------------------------------------------------\n");
+    printf("| TLB LEVEL | ENTRIES |  WAYS  |    LOOKUPS     |      HITS      | HIT RATE |\n");
+    printf("-----------------------------------------------------------------------------\n");
+    for(unsigned int level = 0; level < tlb->count; level++){
+        unsigned long long lookups = 0, hits = 0;
+        for(int kind = 0; kind < PAGEKINDS; kind++){
+            lookups += tlb->levels[level][kind].events;
+            hits += tlb->levels[level][kind].hits;
+        }
+        printf("| L%-8u | %7u | %6u | %14llu | %14llu | %8.6f |\n", level + 1,
+               tlb->levels[level][0].sets * tlb->levels[level][0].ways,
+               tlb->levels[level][0].ways, lookups, hits, lookups ? hits/(double)lookups : 0.0);
+    }
+    printf("-----------------------------------------------------------------------------\n");
+    for(int kind = 0; kind < PAGEKINDS; kind++)
+        walks += tlb->walks[kind];
+    printf("%llu translations of %s pages, %llu page walks (%llu 4k, %llu 2m, %llu 1g), "
+           "%llu page table reads\n", tlb->translations, pageMappingNames[tlb->mapping], walks,
+           tlb->walks[PAGE4K], tlb->walks[PAGE2M], tlb->walks[PAGE1G], tlb->walkReads);
+    printf("Walks cost %llu cycles at %u per read, %.3f per translation",
+           tlb->walkReads * tlb->walkCycles, tlb->walkCycles,
+           tlb->translations ? tlb->walkReads * tlb->walkCycles/(double)tlb->translations : 0.0);
+    if(tlb->walksToCache)
+        printf("; %llu of the reads hit the data cache", tlb->walkHits);
+    printf("\n\n");
+}
+
+#endif
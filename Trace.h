@@ -0,0 +1,1023 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+/* mmap, madvise, kill and the other POSIX calls are hidden by a strict
+-std=c11, so the programs define _DEFAULT_SOURCE before their first system
+header; this only helps a program that includes Trace.h first */
+#ifndef _DEFAULT_SOURCE
+#define _DEFAULT_SOURCE
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <string.h>
+#include <time.h>
+#include <sys/types.h>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#endif
+
+/* The SSSE3 parser is compiled for every x86 build and selected at runtime,
+so a plain build still parses with SIMD on machines that support it */
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define TRACE_SIMD 1
+#include <immintrin.h>
+#endif
+
+/* Types of access; CacheEngine.h declares them too */
+#ifndef ACCESS_TYPES
+#define ACCESS_TYPES
+enum access { READ = 0, WRITE };
+#endif
+
+/* Bytes buffered from a pipe; the buffer only grows past this for a
+binary block that does not fit */
+#define TRACESTREAM (1 << 20)
+
+/* An open trace file. A regular file is mapped in memory whole; standard
+input and pipes are read into a buffer of fixed size as the addresses are
+needed, so a trace can be simulated while it is being produced. Files
+compressed with gzip or zstd are read as the pipe of a decompressor. Either
+way the addresses are parsed in batches from the current position */
+struct trace{
+    const char   *data;         /* Contents of the trace file, or the buffer */
+    size_t       size;          /* Bytes in the file, or buffered */
+    size_t       position;      /* Next byte to parse */
+    int          mapped;        /* 1 if data is a mapping, 0 if it was read */
+    int          streaming;     /* 1 if the trace is read from a pipe */
+    int          fd;            /* Descriptor of the pipe */
+    pid_t        decompressor; /* Process decompressing the file, or 0 */
+    int          ended;         /* 1 once the pipe has been closed */
+    int          failed;        /* 1 once a read failed or a block was corrupt */
+    size_t       capacity;      /* Bytes in the buffer of a pipe */
+    size_t       consumed;      /* Bytes dropped from the buffer so far */
+    unsigned long long accesses; /* Addresses read so far */
+    int          simd;          /* 1 if the SSSE3 parser can be used */
+    int          binary;        /* 1 if the file is in the binary format */
+    int          typed;         /* 1 if a binary trace has access types */
+    size_t       header;        /* Bytes before the first block */
+    unsigned int blockLeft;     /* Addresses left in the current block */
+    unsigned int previous;      /* Last address decoded in the block */
+    double       parseSeconds;  /* Time spent parsing addresses */
+};
+
+/* The binary format starts with TRACEMAGIC, a version and, since version
+2, a word of flags; it is followed by blocks of up to TRACEBLOCK addresses.
+Every block starts with its number of addresses and its size in bytes,
+both as 32 bit little endian numbers, so a reader can skip a block without
+decoding it. The addresses
+are stored as the zigzag varint of their difference with the previous
+address of the block; the first one is relative to 0, so every block can
+be decoded on its own. With the TYPEDTRACE flag every varint is followed by
+a byte with the size of the access, up to 127, and a 1 for writes in its
+low bit */
+#define TRACEMAGIC     "CTRB"
+#define TRACEVERSION   2
+#define TRACEHEADER    12
+#define TYPEDTRACE     1
+#define TRACEBLOCK     65536
+#define BLOCKHEADER    8
+#define MAXVARINT      5
+#define MAXBLOCKBYTES  (TRACEBLOCK * (MAXVARINT + 1))
+
+/* Where a trace was between two reads, so a checkpoint can resume it */
+struct traceMark{
+    unsigned long long accesses;    /* Addresses read before the mark */
+    unsigned long long offset;      /* Byte of the file to parse next */
+    unsigned int       blockLeft;   /* State of the binary decoder */
+    unsigned int       previous;
+};
+
+/* A binary trace being written; a block is encoded in memory and written
+when it is full */
+struct traceWriter{
+    FILE          *fp;
+    unsigned char *buffer;      /* Encoded addresses of the block */
+    size_t        bytes;        /* Bytes used in the buffer */
+    unsigned int  count;        /* Addresses in the block */
+    unsigned int  previous;     /* Last address of the block */
+    int           typed;        /* 1 to store the types and sizes */
+};
+
+/**********************************************************************/
+/* Name:        wallClock                                             */
+/*                                                                    */
+/* Description: This function will return a monotonic time stamp      */
+/*                                                                    */
+/* Inputs:      NONE                                                  */
+/*                                                                    */
+/* Outputs:     The time in seconds                                   */
+/**********************************************************************/
+double wallClock(void){
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec/1e9;
+}
+
+/**********************************************************************/
+/* Name:        hexDigit                                              */
+/*                                                                    */
+/* Description: This function will return the value of a hexadecimal  */
+/*              digit                                                 */
+/*                                                                    */
+/* Inputs:      A character                                           */
+/*                                                                    */
+/* Outputs:     The value of the digit, -1 if it is not a hex digit   */
+/**********************************************************************/
+int hexDigit(unsigned char c){
+    if(c >= '0' && c <= '9')
+        return c - '0';
+    c |= 0x20;                                    /* Lower case letter */
+    if(c >= 'a' && c <= 'f')
+        return c - 'a' + 10;
+    return -1;
+}
+
+#ifdef TRACE_SIMD
+/**********************************************************************/
+/* Name:        parseHexSimd                                          */
+/*                                                                    */
+/* Description: This function will parse a hexadecimal number of up   */
+/*              to 8 digits with a single pass of SSSE3 instructions: */
+/*              the 16 bytes at the pointer are classified and turned */
+/*              into nibbles, the digits of the number are moved to   */
+/*              the right of an 8 byte lane and then combined in      */
+/*              pairs with multiply-add instructions                  */
+/*                                                                    */
+/* Inputs:      A pointer with at least 16 readable bytes; the        */
+/*              variable that will hold the number                    */
+/*                                                                    */
+/* Outputs:     The number of digits, 0 if there are more than 8      */
+/**********************************************************************/
+__attribute__((target("ssse3")))
+int parseHexSimd(const char *p, unsigned int *address){
+
+    __m128i text = _mm_loadu_si128((const __m128i *)p);
+    __m128i lower = _mm_or_si128(text, _mm_set1_epi8(0x20));
+
+    /* Classify the characters; bytes above 0x7f are negative and fail both
+    comparisons */
+    __m128i isDigit = _mm_and_si128(_mm_cmpgt_epi8(text, _mm_set1_epi8('0' - 1)),
+                                    _mm_cmplt_epi8(text, _mm_set1_epi8('9' + 1)));
+    __m128i isLetter = _mm_and_si128(_mm_cmpgt_epi8(lower, _mm_set1_epi8('a' - 1)),
+                                     _mm_cmplt_epi8(lower, _mm_set1_epi8('f' + 1)));
+    unsigned int mask = (unsigned int)_mm_movemask_epi8(_mm_or_si128(isDigit, isLetter));
+
+    /* Number of digits at the start of the text */
+    int length = __builtin_ctz(~mask);
+    if(length == 0 || length > 8)
+        return 0;
+
+    __m128i nibbles = _mm_or_si128(
+        _mm_and_si128(isDigit, _mm_sub_epi8(text, _mm_set1_epi8('0'))),
+        _mm_and_si128(isLetter, _mm_sub_epi8(lower, _mm_set1_epi8('a' - 10))));
+
+    /* Move the digits to the end of the low 8 bytes; negative indexes and
+    the high 8 bytes select zeros */
+    __m128i shuffle = _mm_add_epi8(_mm_setr_epi8(0, 1, 2, 3, 4, 5, 6, 7, 0, 0, 0, 0, 0, 0, 0, 0),
+                                   _mm_set1_epi8((char)(length - 8)));
+    shuffle = _mm_or_si128(shuffle, _mm_setr_epi8(0, 0, 0, 0, 0, 0, 0, 0,
+                                                  -128, -128, -128, -128, -128, -128, -128, -128));
+    nibbles = _mm_shuffle_epi8(nibbles, shuffle);
+
+    /* Digit pairs into bytes, byte pairs into 16 bit halves */
+    __m128i bytes = _mm_maddubs_epi16(nibbles, _mm_setr_epi8(16, 1, 16, 1, 16, 1, 16, 1,
+                                                             16, 1, 16, 1, 16, 1, 16, 1));
+    __m128i halves = _mm_madd_epi16(bytes, _mm_setr_epi16(256, 1, 256, 1, 256, 1, 256, 1));
+
+    unsigned int high = (unsigned int)_mm_cvtsi128_si32(halves);
+    unsigned int low = (unsigned int)_mm_cvtsi128_si32(_mm_srli_si128(halves, 4));
+    *address = (high << 16) | low;
+    return length;
+}
+#endif
+
+/**********************************************************************/
+/* Name:        readWord                                              */
+/*                                                                    */
+/* Description: This function will read a 32 bit little endian number */
+/*                                                                    */
+/* Inputs:      A pointer to 4 bytes                                  */
+/*                                                                    */
+/* Outputs:     The number                                            */
+/**********************************************************************/
+unsigned int readWord(const unsigned char *p){
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((unsigned int)p[3] << 24);
+}
+
+/**********************************************************************/
+/* Name:        writeWord                                             */
+/*                                                                    */
+/* Description: This function will write a 32 bit little endian       */
+/*              number                                                */
+/*                                                                    */
+/* Inputs:      A pointer to 4 bytes; the number                      */
+/*                                                                    */
+/* Outputs:     NONE                                                  */
+/**********************************************************************/
+void writeWord(unsigned char *p, unsigned int word){
+    p[0] = word & 0xff;
+    p[1] = (word >> 8) & 0xff;
+    p[2] = (word >> 16) & 0xff;
+    p[3] = word >> 24;
+}
+
+#ifndef _WIN32
+/**********************************************************************/
+/* Name:        traceReap                                             */
+/*                                                                    */
+/* Description: This function will wait for the decompressor of a     */
+/*              trace to exit                                         */
+/*                                                                    */
+/* Inputs:      The process                                           */
+/*                                                                    */
+/* Outputs:     0 if it decompressed the whole file, -1 if it failed, */
+/*              was killed or could not run                           */
+/**********************************************************************/
+int traceReap(pid_t process){
+
+    int status;
+
+    while(waitpid(process, &status, 0) < 0)
+        if(errno != EINTR)
+            return -1;
+    return WIFEXITED(status) && WEXITSTATUS(status) == 0 ? 0 : -1;
+}
+#endif
+
+/**********************************************************************/
+/* Name:        traceClose                                            */
+/*                                                                    */
+/* Description: This function will release a trace file               */
+/*                                                                    */
+/* Inputs:      The trace                                             */
+/*                                                                    */
+/* Outputs:     0 on success, -1 if the trace could not be read to    */
+/*              its end, was corrupt or its decompressor failed       */
+/**********************************************************************/
+int traceClose(struct trace *trace){
+#ifndef _WIN32
+    if(trace->streaming && trace->fd != STDIN_FILENO)
+        close(trace->fd);
+
+    /* A decompressor stopped before the end of its output dies of the
+    closed pipe; it only fails the run if all of it was read */
+    if(trace->decompressor != 0 && traceReap(trace->decompressor) != 0 && trace->ended)
+        trace->failed = 1;
+    trace->decompressor = 0;
+    if(trace->mapped)
+        munmap((void *)trace->data, trace->size);
+    else
+#endif
+        free((void *)trace->data);
+    trace->data = NULL;
+    return trace->failed ? -1 : 0;
+}
+
+#ifndef _WIN32
+/**********************************************************************/
+/* Name:        traceFill                                             */
+/*                                                                    */
+/* Description: This function will drop the parsed bytes of a pipe     */
+/*              from its buffer and read more, waiting until some     */
+/*              arrive or the pipe is closed                          */
+/*                                                                    */
+/* Inputs:      The trace; the bytes the buffer must be able to hold  */
+/*                                                                    */
+/* Outputs:     0 on success, -1 on a read error or no memory         */
+/**********************************************************************/
+int traceFill(struct trace *trace, size_t needed){
+
+    char *buffer = (char *)trace->data;
+    size_t left = trace->size - trace->position;
+
+    memmove(buffer, buffer + trace->position, left);
+    trace->consumed += trace->position;
+    trace->position = 0;
+    trace->size = left;
+
+    if(needed > trace->capacity){
+        buffer = realloc(buffer, needed);
+        if(buffer == NULL)
+            return -1;
+        trace->data = buffer;
+        trace->capacity = needed;
+    }
+
+    while(trace->size < trace->capacity && !trace->ended){
+        ssize_t bytes = read(trace->fd, buffer + trace->size, trace->capacity - trace->size);
+        if(bytes < 0)
+            return -1;
+        if(bytes == 0)
+            trace->ended = 1;
+        trace->size += (size_t)bytes;
+        if(trace->size >= needed)
+            break;
+    }
+    return 0;
+}
+
+/**********************************************************************/
+/* Name:        traceDecompressor                                     */
+/*                                                                    */
+/* Description: This function will start the decompressor of a file   */
+/*              named .gz or .zst, without a shell, writing to a pipe */
+/*                                                                    */
+/* Inputs:      The name of the file; the process to set              */
+/*                                                                    */
+/* Outputs:     The end of the pipe to read, -1 if the file is not    */
+/*              compressed or the decompressor cannot start           */
+/**********************************************************************/
+int traceDecompressor(const char *name, pid_t *process){
+
+    size_t length = strlen(name);
+    const char *program, *options;
+    int fds[2];
+    pid_t pid;
+
+    if(length > 3 && strcmp(name + length - 3, ".gz") == 0){
+        program = "gzip";
+        options = "-dc";
+    }
+    else if(length > 4 && strcmp(name + length - 4, ".zst") == 0){
+        program = "zstd";
+        options = "-dcq";
+    }
+    else
+        return -1;
+    if(access(name, R_OK) != 0 || pipe(fds) != 0)
+        return -1;
+
+    pid = fork();
+    if(pid < 0){
+        close(fds[0]);
+        close(fds[1]);
+        return -1;
+    }
+    if(pid == 0){
+        /* A decompressor that cannot run exits like one that failed */
+        close(fds[0]);
+        if(dup2(fds[1], STDOUT_FILENO) < 0)
+            _exit(127);
+        close(fds[1]);
+        execlp(program, program, options, "--", name, (char *)NULL);
+        _exit(127);
+    }
+    close(fds[1]);
+    fcntl(fds[0], F_SETFD, FD_CLOEXEC);
+    *process = pid;
+    return fds[0];
+}
+
+#endif
+/**********************************************************************/
+/* Name:        traceOpen                                             */
+/*                                                                    */
+/* Description: This function will map a trace file in memory so it   */
+/*              can be parsed without copying it through stdio. A     */
+/*              name of - stands for standard input; it and other     */
+/*              pipes are read as a stream, like the output of the    */
+/*              decompressor of a .gz or .zst file                    */
+/*                                                                    */
+/* Inputs:      The trace; the name of the input file                 */
+/*                                                                    */
+/* Outputs:     0 on success, -1 if the file cannot be read           */
+/**********************************************************************/
+int traceOpen(struct trace *trace, const char *name){
+
+    memset(trace, 0, sizeof(*trace));
+#ifdef TRACE_SIMD
+    trace->simd = __builtin_cpu_supports("ssse3");
+#endif
+
+#ifdef _WIN32
+    /* Without mmap the file is read in a single block */
+    FILE *fp = fopen(name, "rb");
+    if(fp == NULL)
+        return -1;
+    fseek(fp, 0, SEEK_END);
+    trace->size = (size_t)ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+    char *buffer = malloc(trace->size + 1);
+    if(buffer == NULL || fread(buffer, 1, trace->size, fp) != trace->size){
+        free(buffer);
+        fclose(fp);
+        return -1;
+    }
+    fclose(fp);
+    trace->data = buffer;
+#else
+    struct stat status;
+    int fd;
+
+    fd = traceDecompressor(name, &trace->decompressor);
+    if(fd < 0)
+        fd = strcmp(name, "-") == 0 ? STDIN_FILENO : open(name, O_RDONLY);
+    if(fd < 0)
+        return -1;
+    if(fstat(fd, &status) != 0){
+        if(fd != STDIN_FILENO)
+            close(fd);
+        if(trace->decompressor != 0)
+            traceReap(trace->decompressor);
+        return -1;
+    }
+
+    /* Anything that cannot be mapped is read as it arrives; the magic
+    number needs the first TRACEHEADER bytes */
+    if(!S_ISREG(status.st_mode)){
+        trace->streaming = 1;
+        trace->fd = fd;
+        trace->data = malloc(TRACESTREAM);
+        trace->capacity = TRACESTREAM;
+        if(trace->data == NULL){
+            traceClose(trace);
+            return -1;
+        }
+        while(trace->size < TRACEHEADER && !trace->ended)
+            if(traceFill(trace, TRACEHEADER) != 0){
+                traceClose(trace);
+                return -1;
+            }
+    }
+    else
+        trace->size = (size_t)status.st_size;
+    if(!trace->streaming && trace->size > 0){
+        void *data = mmap(NULL, trace->size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if(data == MAP_FAILED){
+            close(fd);
+            return -1;
+        }
+        madvise(data, trace->size, MADV_SEQUENTIAL);
+        trace->data = data;
+        trace->mapped = 1;
+    }
+    if(!trace->streaming && fd != STDIN_FILENO)
+        close(fd);
+#endif
+
+    /* Binary traces are recognised by their magic number; version 1 had
+    no flags */
+    if(trace->size >= 8 && memcmp(trace->data, TRACEMAGIC, 4) == 0){
+        unsigned int version = readWord((const unsigned char *)trace->data + 4);
+        if(version == 1)
+            trace->header = 8;
+        else if(version == TRACEVERSION && trace->size >= TRACEHEADER){
+            trace->header = TRACEHEADER;
+            trace->typed = readWord((const unsigned char *)trace->data + 8) & TYPEDTRACE;
+        }
+        else{
+            traceClose(trace);
+            return -1;
+        }
+        trace->binary = 1;
+        trace->position = trace->header;
+    }
+    return 0;
+}
+
+/**********************************************************************/
+/* Name:        traceReadText                                         */
+/*                                                                    */
+/* Description: This function will parse the next addresses of a      */
+/*              text trace. It will skip over comments, which begin   */
+/*              with a #, and over any character that is not part of  */
+/*              a hexadecimal number. An R or a W before an address   */
+/*              gives the type of the access, a read otherwise, and a */
+/*              colon and a decimal number after it its size, as in   */
+/*              W 3c5c:8; any other number is the next address.       */
+/*              An address of more than 32 bits fails the trace       */
+/*                                                                    */
+/* Inputs:      The trace; an array for the addresses; arrays for the */
+/*              types and the sizes, or NULL; the length of the       */
+/*              arrays                                                */
+/*                                                                    */
+/* Outputs:     The number of addresses read, 0 at the end of file or */
+/*              at the first address that does not fit                */
+/**********************************************************************/
+size_t traceReadText(struct trace *trace, unsigned int addresses[], unsigned char types[],
+                     unsigned char sizes[], size_t count){
+
+    const char *p = trace->data + trace->position;
+    const char *end = trace->data + trace->size;
+    unsigned char type = READ;
+    size_t n = 0;
+
+    while(n < count && p < end && !trace->failed){
+
+        /* Skip the comment */
+        if(*p == '#'){
+            p = memchr(p, '\n', (size_t)(end - p));
+            if(p == NULL)
+                p = end;
+            continue;
+        }
+        if(hexDigit((unsigned char)*p) < 0){
+            if((*p | 0x20) == 'w')
+                type = WRITE;
+            else if((*p | 0x20) == 'r')
+                type = READ;
+            p++;
+            continue;
+        }
+
+        /* An optional 0x prefix */
+        if(p[0] == '0' && end - p > 2 && (p[1] | 0x20) == 'x' && hexDigit((unsigned char)p[2]) >= 0)
+            p += 2;
+
+        unsigned int address = 0;
+        int length = 0;
+#ifdef TRACE_SIMD
+        if(trace->simd && end - p >= 16)
+            length = parseHexSimd(p, &address);
+#endif
+        if(length > 0)
+            p += length;
+        else{
+            const char *start = p;
+            int digit;
+            while(p < end && (digit = hexDigit((unsigned char)*p)) >= 0){
+                if(address >> 28 != 0){
+                    p = start;
+                    trace->failed = 1;
+                    break;
+                }
+                address = (address << 4) | (unsigned int)digit;
+                p++;
+            }
+            if(trace->failed)
+                break;
+        }
+
+        /* The size, if any, follows a colon, with blanks around it or
+        not; it saturates at 255 */
+        unsigned int size = 0;
+        const char *colon = p;
+        while(colon < end && (*colon == ' ' || *colon == '\t'))
+            colon++;
+        if(colon < end && *colon == ':'){
+            p = colon + 1;
+            while(p < end && (*p == ' ' || *p == '\t'))
+                p++;
+            while(p < end && *p >= '0' && *p <= '9'){
+                if(size < 256)
+                    size = size * 10 + (unsigned int)(*p - '0');
+                p++;
+            }
+        }
+
+        if(types != NULL)
+            types[n] = type;
+        if(sizes != NULL)
+            sizes[n] = size > 255 ? 255 : (unsigned char)size;
+        addresses[n++] = address;
+        type = READ;
+    }
+
+    trace->position = (size_t)(p - trace->data);
+    return n;
+}
+
+/**********************************************************************/
+/* Name:        readVarint                                            */
+/*                                                                    */
+/* Description: This function will finish decoding a varint of more   */
+/*              than one byte, which fits in 32 bits and so takes at  */
+/*              most MAXVARINT bytes                                  */
+/*                                                                    */
+/* Inputs:      The position after the first byte; the end of the     */
+/*              data; the value with the first byte                   */
+/*                                                                    */
+/* Outputs:     0 on success, -1 if the varint is too long or runs    */
+/*              past the end                                          */
+/**********************************************************************/
+int readVarint(const unsigned char **position, const unsigned char *end, unsigned int *value){
+
+    const unsigned char *p = *position;
+    unsigned int result = *value & 0x7f;
+
+    for(int shift = 7; p < end; shift += 7){
+        unsigned int byte = *p++;
+        /* The last byte only holds the top 4 bits */
+        if(shift == 7 * (MAXVARINT - 1) && byte > 0x0f)
+            return -1;
+        result |= (byte & 0x7f) << shift;
+        if(!(byte & 0x80)){
+            *position = p;
+            *value = result;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+/**********************************************************************/
+/* Name:        traceReadBinary                                       */
+/*                                                                    */
+/* Description: This function will decode the next addresses of a     */
+/*              binary trace, moving to the next block when the       */
+/*              current one is exhausted. Traces written without      */
+/*              access types only have reads of unknown size          */
+/*                                                                    */
+/* Inputs:      The trace; an array for the addresses; arrays for the */
+/*              types and the sizes, or NULL; the length of the       */
+/*              arrays                                                */
+/*                                                                    */
+/* Outputs:     The number of addresses read, 0 at the end of file or */
+/*              of the last good block                                */
+/**********************************************************************/
+size_t traceReadBinary(struct trace *trace, unsigned int addresses[], unsigned char types[],
+                       unsigned char sizes[], size_t count){
+
+    const unsigned char *p = (const unsigned char *)trace->data + trace->position;
+    const unsigned char *end = (const unsigned char *)trace->data + trace->size;
+    unsigned int previous = trace->previous;
+    unsigned int left = trace->blockLeft;
+    unsigned int access = 0;
+    size_t n = 0;
+
+    while(n < count && !trace->failed){
+
+        /* Start the next block */
+        if(left == 0){
+            if(end - p < BLOCKHEADER)
+                break;
+            left = readWord(p);
+            if(left > TRACEBLOCK || readWord(p + 4) > MAXBLOCKBYTES){
+                trace->failed = 1;
+                left = 0;
+                break;
+            }
+            p += BLOCKHEADER;
+            previous = 0;
+            continue;
+        }
+
+        /* Decode the varint; the single byte case is the common one */
+        unsigned int value = *p++;
+        if((value & 0x80) && readVarint(&p, end, &value) != 0){
+            trace->failed = 1;
+            left = 0;
+            break;
+        }
+        if(trace->typed){
+            if(p == end){
+                trace->failed = 1;              /* Truncated trace */
+                left = 0;
+                break;
+            }
+            access = *p++;
+        }
+
+        /* Undo the zigzag and the delta */
+        previous += (value >> 1) ^ (0u - (value & 1));
+        if(types != NULL)
+            types[n] = access & 1;
+        if(sizes != NULL)
+            sizes[n] = (unsigned char)(access >> 1);
+        addresses[n++] = previous;
+        left--;
+        if(p >= end && left > 0){
+            trace->failed = 1;                  /* Truncated trace */
+            left = 0;
+        }
+    }
+
+    trace->position = (size_t)(p - (const unsigned char *)trace->data);
+    trace->previous = previous;
+    trace->blockLeft = left;
+    return n;
+}
+
+/**********************************************************************/
+/* Name:        traceReadAccesses                                     */
+/*                                                                    */
+/* Description: This function will read the next addresses of a text  */
+/*              or binary trace, with the type and the size of every  */
+/*              access; a size of 0 means it was not given. A pipe is */
+/*              only parsed up to its last complete line or block,    */
+/*              and read again when nothing complete is buffered      */
+/*                                                                    */
+/* Inputs:      The trace; an array for the addresses; arrays for the */
+/*              types and the sizes, or NULL; the length of the       */
+/*              arrays                                                */
+/*                                                                    */
+/* Outputs:     The number of addresses read, 0 at the end of file    */
+/**********************************************************************/
+size_t traceReadAccesses(struct trace *trace, unsigned int addresses[], unsigned char types[],
+                         unsigned char sizes[], size_t count){
+
+    double start = wallClock();
+    size_t n;
+
+    for(;;){
+        size_t size = trace->size;
+        size_t needed = 0;
+
+#ifndef _WIN32
+        /* A line longer than the whole buffer is parsed as it is; a
+        binary read stops at the end of its block, which is buffered */
+        if(trace->streaming && !trace->ended){
+            const unsigned char *data = (const unsigned char *)trace->data;
+            if(!trace->binary && trace->position + trace->capacity > trace->size){
+                const char *end = trace->data + trace->size;
+                while(end > trace->data + trace->position && end[-1] != '\n')
+                    end--;
+                trace->size = (size_t)(end - trace->data);
+            }
+            else if(trace->binary && trace->blockLeft == 0){
+                size_t left = trace->size - trace->position;
+                needed = BLOCKHEADER;
+                if(left >= BLOCKHEADER){
+                    if(readWord(data + trace->position + 4) > MAXBLOCKBYTES){
+                        trace->failed = 1;
+                        return 0;
+                    }
+                    needed += readWord(data + trace->position + 4);
+                }
+                if(left < needed)
+                    trace->size = trace->position;
+                else if(count > readWord(data + trace->position))
+                    count = readWord(data + trace->position);
+            }
+            else if(trace->binary && count > trace->blockLeft)
+                count = trace->blockLeft;
+        }
+#endif
+
+        if(trace->binary)
+            n = traceReadBinary(trace, addresses, types, sizes, count);
+        else
+            n = traceReadText(trace, addresses, types, sizes, count);
+        if(size > trace->size)
+            trace->size = size;
+
+#ifndef _WIN32
+        if(n == 0 && trace->streaming && !trace->ended && !trace->failed){
+            trace->parseSeconds += wallClock() - start;
+            if(traceFill(trace, needed) != 0){
+                trace->failed = 1;
+                return 0;
+            }
+            start = wallClock();
+            continue;
+        }
+#endif
+        break;
+    }
+
+    trace->parseSeconds += wallClock() - start;
+    trace->accesses += n;
+    return n;
+}
+
+/**********************************************************************/
+/* Name:        traceRead                                             */
+/*                                                                    */
+/* Description: This function will read the next addresses of a text  */
+/*              or binary trace                                       */
+/*                                                                    */
+/* Inputs:      The trace; an array for the addresses; its length     */
+/*                                                                    */
+/* Outputs:     The number of addresses read, 0 at the end of file    */
+/**********************************************************************/
+size_t traceRead(struct trace *trace, unsigned int addresses[], size_t count){
+    return traceReadAccesses(trace, addresses, NULL, NULL, count);
+}
+
+/**********************************************************************/
+/* Name:        traceSeekBlock                                        */
+/*                                                                    */
+/* Description: This function will move a binary trace to the start   */
+/*              of a block, skipping the blocks before it by their    */
+/*              headers                                               */
+/*                                                                    */
+/* Inputs:      The trace; the number of the block                    */
+/*                                                                    */
+/* Outputs:     0 on success, -1 if the trace has fewer blocks        */
+/**********************************************************************/
+int traceSeekBlock(struct trace *trace, size_t block){
+
+    const unsigned char *data = (const unsigned char *)trace->data;
+    size_t position = trace->header;
+
+    if(!trace->binary)
+        return -1;
+    for(size_t i = 0; i < block; i++){
+        if(trace->size - position < BLOCKHEADER)
+            return -1;
+        position += BLOCKHEADER + readWord(data + position + 4);
+    }
+    if(position > trace->size)
+        return -1;
+
+    trace->position = position;
+    trace->blockLeft = 0;
+    trace->previous = 0;
+    return 0;
+}
+
+/**********************************************************************/
+/* Name:        traceMarkPosition                                     */
+/*                                                                    */
+/* Description: This function will record where the next read of a    */
+/*              trace starts                                          */
+/*                                                                    */
+/* Inputs:      The trace; the mark                                   */
+/*                                                                    */
+/* Outputs:     NONE                                                  */
+/**********************************************************************/
+void traceMarkPosition(struct trace *trace, struct traceMark *mark){
+    mark->accesses = trace->accesses;
+    mark->offset = trace->consumed + trace->position;
+    mark->blockLeft = trace->blockLeft;
+    mark->previous = trace->previous;
+}
+
+/**********************************************************************/
+/* Name:        traceResume                                           */
+/*                                                                    */
+/* Description: This function will move a trace that was just opened  */
+/*              past a number of addresses. A mapped file jumps to a  */
+/*              mark taken at or before them and parses the rest; a   */
+/*              pipe cannot jump, so it parses them all               */
+/*                                                                    */
+/* Inputs:      The trace; the mark; the addresses to skip            */
+/*                                                                    */
+/* Outputs:     0 on success, -1 if the trace is shorter or the mark  */
+/*              is not in it                                          */
+/**********************************************************************/
+int traceResume(struct trace *trace, const struct traceMark *mark, unsigned long long accesses){
+
+    unsigned int discard[4096];
+
+    if(!trace->streaming && mark->accesses <= accesses){
+        if(mark->offset < trace->header || mark->offset > trace->size)
+            return -1;
+        trace->position = (size_t)mark->offset;
+        trace->blockLeft = mark->blockLeft;
+        trace->previous = mark->previous;
+        trace->accesses = mark->accesses;
+    }
+    while(trace->accesses < accesses){
+        unsigned long long left = accesses - trace->accesses;
+        size_t count = left < 4096 ? (size_t)left : 4096;
+        if(traceRead(trace, discard, count) == 0)
+            return -1;
+    }
+    return 0;
+}
+
+/**********************************************************************/
+/* Name:        traceFlushBlock                                       */
+/*                                                                    */
+/* Description: This function will write the block being encoded      */
+/*                                                                    */
+/* Inputs:      The trace writer                                      */
+/*                                                                    */
+/* Outputs:     0 on success, -1 on a write error                     */
+/**********************************************************************/
+int traceFlushBlock(struct traceWriter *writer){
+
+    unsigned char header[BLOCKHEADER];
+
+    if(writer->count == 0)
+        return 0;
+    writeWord(header, writer->count);
+    writeWord(header + 4, (unsigned int)writer->bytes);
+    if(fwrite(header, 1, BLOCKHEADER, writer->fp) != BLOCKHEADER ||
+       fwrite(writer->buffer, 1, writer->bytes, writer->fp) != writer->bytes)
+        return -1;
+
+    writer->bytes = 0;
+    writer->count = 0;
+    writer->previous = 0;
+    return 0;
+}
+
+/**********************************************************************/
+/* Name:        traceWriterOpen                                       */
+/*                                                                    */
+/* Description: This function will create a binary trace file         */
+/*                                                                    */
+/* Inputs:      The trace writer; the name of the output file; 1 to   */
+/*              store the type and size of every access               */
+/*                                                                    */
+/* Outputs:     0 on success, -1 if the file cannot be created        */
+/**********************************************************************/
+int traceWriterOpen(struct traceWriter *writer, const char *name, int typed){
+
+    unsigned char header[TRACEHEADER];
+
+    memset(writer, 0, sizeof(*writer));
+    writer->typed = typed;
+    writer->buffer = malloc((size_t)TRACEBLOCK * (MAXVARINT + 1));
+    writer->fp = fopen(name, "wb");
+    if(writer->buffer == NULL || writer->fp == NULL){
+        if(writer->fp != NULL)
+            fclose(writer->fp);
+        free(writer->buffer);
+        return -1;
+    }
+
+    memcpy(header, TRACEMAGIC, 4);
+    writeWord(header + 4, TRACEVERSION);
+    writeWord(header + 8, typed ? TYPEDTRACE : 0);
+    if(fwrite(header, 1, TRACEHEADER, writer->fp) != TRACEHEADER){
+        fclose(writer->fp);
+        free(writer->buffer);
+        return -1;
+    }
+    return 0;
+}
+
+/**********************************************************************/
+/* Name:        traceWriteAccess                                      */
+/*                                                                    */
+/* Description: This function will append an access to a binary       */
+/*              trace; the type and size are only kept if the trace   */
+/*              was opened with them                                  */
+/*                                                                    */
+/* Inputs:      The trace writer; the address; the type of access;    */
+/*              the size, 0 if it is not known                        */
+/*                                                                    */
+/* Outputs:     0 on success, -1 on a write error                     */
+/**********************************************************************/
+int traceWriteAccess(struct traceWriter *writer, unsigned int address, int type,
+                     unsigned int size){
+
+    /* Zigzag the difference so small negative strides stay small */
+    int delta = (int)(address - writer->previous);
+    unsigned int value = ((unsigned int)delta << 1) ^ (unsigned int)(delta >> 31);
+    unsigned char *p = writer->buffer + writer->bytes;
+
+    while(value >= 0x80){
+        *p++ = (unsigned char)(value | 0x80);
+        value >>= 7;
+    }
+    *p++ = (unsigned char)value;
+    if(writer->typed)
+        *p++ = (unsigned char)(((size > 127 ? 127 : size) << 1) | (type == WRITE));
+
+    writer->bytes = (size_t)(p - writer->buffer);
+    writer->previous = address;
+    if(++writer->count == TRACEBLOCK)
+        return traceFlushBlock(writer);
+    return 0;
+}
+
+/**********************************************************************/
+/* Name:        traceWrite                                            */
+/*                                                                    */
+/* Description: This function will append a read to a binary trace    */
+/*                                                                    */
+/* Inputs:      The trace writer; the address                         */
+/*                                                                    */
+/* Outputs:     0 on success, -1 on a write error                     */
+/**********************************************************************/
+int traceWrite(struct traceWriter *writer, unsigned int address){
+    return traceWriteAccess(writer, address, READ, 0);
+}
+
+/**********************************************************************/
+/* Name:        traceWriterClose                                      */
+/*                                                                    */
+/* Description: This function will write the last block of a binary   */
+/*              trace and close the file                              */
+/*                                                                    */
+/* Inputs:      The trace writer                                      */
+/*                                                                    */
+/* Outputs:     0 on success, -1 on a write error                     */
+/**********************************************************************/
+int traceWriterClose(struct traceWriter *writer){
+
+    int status = traceFlushBlock(writer);
+    if(fclose(writer->fp) != 0)
+        status = -1;
+    free(writer->buffer);
+    return status;
+}
+
+/**********************************************************************/
+/* Name:        traceThroughput                                       */
+/*                                                                    */
+/* Description: This function will compute the parse throughput of    */
+/*              the part of the trace read so far                     */
+/*                                                                    */
+/* Inputs:      The trace                                             */
+/*                                                                    */
+/* Outputs:     The throughput in MB/s                                */
+/**********************************************************************/
+double traceThroughput(struct trace *trace){
+    if(trace->parseSeconds <= 0)
+        return 0;
+    return (trace->consumed + trace->position)/1e6/trace->parseSeconds;
+}
+
+#endif
@@ -0,0 +1,63 @@
+#define _DEFAULT_SOURCE
+
+#include <stdio.h>
+#include <string.h>
+
+#include "Trace.h"
+
+#define CONVERTBATCH 4096
+
+int main(int argc, char *argv[]){
+
+    struct trace       trace;
+    struct traceWriter writer;
+    unsigned int       batch[CONVERTBATCH];
+    unsigned char      types[CONVERTBATCH];
+    unsigned char      sizes[CONVERTBATCH];
+    size_t             count;
+    unsigned long      events = 0;
+    int                typed = 0;
+
+    /* -a keeps the type and size of every access */
+    if(argc == 4 && strcmp(argv[1], "-a") == 0){
+        typed = 1;
+        argv++;
+        argc--;
+    }
+    if(argc != 3){
+        fprintf(stderr, "usage: %s [-a] <text trace> <binary trace>\n", argv[0]);
+        fprintf(stderr, "  -a  keep the R/W type and the size of every access\n");
+        return 1;
+    }
+    if(traceOpen(&trace, argv[1]) != 0){
+        fprintf(stderr, "%s: cannot read %s\n", argv[0], argv[1]);
+        return 1;
+    }
+    if(traceWriterOpen(&writer, argv[2], typed) != 0){
+        fprintf(stderr, "%s: cannot create %s\n", argv[0], argv[2]);
+        traceClose(&trace);
+        return 1;
+    }
+
+    /* Re-encode the addresses; a binary input is simply re-blocked */
+    while((count = traceReadAccesses(&trace, batch, types, sizes, CONVERTBATCH)) > 0){
+        for(size_t i = 0; i < count; i++){
+            if(traceWriteAccess(&writer, batch[i], types[i], sizes[i]) != 0){
+                fprintf(stderr, "%s: cannot write %s\n", argv[0], argv[2]);
+                return 1;
+            }
+        }
+        events += count;
+    }
+
+    if(traceWriterClose(&writer) != 0){
+        fprintf(stderr, "%s: cannot write %s\n", argv[0], argv[2]);
+        return 1;
+    }
+    if(traceClose(&trace) != 0){
+        fprintf(stderr, "%s: %s is truncated or corrupt\n", argv[0], argv[1]);
+        return 1;
+    }
+    printf("%lu addresses converted\n", events);
+    return 0;
+}
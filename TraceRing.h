@@ -0,0 +1,290 @@
+#ifndef TRACE_RING_H
+#define TRACE_RING_H
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "Trace.h"
+
+/* Accesses in a block of the ring, and blocks in the ring; a power of two
+so the positions wrap with a mask */
+#define RINGBLOCK  4096
+#define RINGBLOCKS 16
+
+/* Polls of an empty or full ring before the thread gives up the processor,
+and yields before it sleeps until the other side signals it */
+#define RINGSPINS  64
+#define RINGYIELDS 64
+
+/* A block of parsed accesses and where the trace was before them */
+struct ringBlock{
+    unsigned int     addresses[RINGBLOCK];
+    unsigned char    types[RINGBLOCK];
+    unsigned char    sizes[RINGBLOCK];
+    size_t           count;         /* 0 for the last block, at the end of the trace */
+    struct traceMark mark;
+};
+
+/* Where a side of a ring that has waited for long sleeps. The other side
+only takes the lock to wake it when it has registered as a sleeper */
+struct ringSignal{
+    pthread_mutex_t  lock;
+    pthread_cond_t   wake;          /* On the monotonic clock of wallClock */
+    atomic_uint      sleepers;
+};
+
+/* A ring of blocks between one thread that reads and parses the trace and
+one that simulates it. Each position is written by a single thread, so the
+ring needs no lock: the producer publishes a block by moving head past it
+and the consumer gives it back by moving tail */
+struct traceRing{
+    struct trace     *trace;
+    struct ringBlock *blocks;
+    pthread_t        thread;
+    struct ringSignal signal;
+    _Alignas(64) atomic_size_t head;   /* Blocks produced */
+    _Alignas(64) atomic_size_t tail;   /* Blocks consumed */
+};
+
+/**********************************************************************/
+/* Name:        ringSignalInit                                        */
+/*                                                                    */
+/* Description: This function will prepare the signal of a ring        */
+/*                                                                    */
+/* Inputs:      The signal                                            */
+/*                                                                    */
+/* Outputs:     0 on success, -1 if the lock cannot be made           */
+/**********************************************************************/
+int ringSignalInit(struct ringSignal *signal){
+
+    pthread_condattr_t attributes;
+    int status = -1;
+
+    atomic_init(&signal->sleepers, 0);
+    if(pthread_condattr_init(&attributes) != 0)
+        return -1;
+    if(pthread_condattr_setclock(&attributes, CLOCK_MONOTONIC) == 0 &&
+       pthread_cond_init(&signal->wake, &attributes) == 0){
+        if(pthread_mutex_init(&signal->lock, NULL) == 0)
+            status = 0;
+        else
+            pthread_cond_destroy(&signal->wake);
+    }
+    pthread_condattr_destroy(&attributes);
+    return status;
+}
+
+/**********************************************************************/
+/* Name:        ringSignalFree                                        */
+/*                                                                    */
+/* Description: This function will release the signal of a ring        */
+/*                                                                    */
+/* Inputs:      The signal                                            */
+/*                                                                    */
+/* Outputs:     NONE                                                  */
+/**********************************************************************/
+void ringSignalFree(struct ringSignal *signal){
+    pthread_cond_destroy(&signal->wake);
+    pthread_mutex_destroy(&signal->lock);
+}
+
+/**********************************************************************/
+/* Name:        ringNotify                                            */
+/*                                                                    */
+/* Description: This function will wake the other side of a ring, if   */
+/*              it sleeps, after a position moved                     */
+/*                                                                    */
+/* Inputs:      The signal                                            */
+/*                                                                    */
+/* Outputs:     NONE                                                  */
+/**********************************************************************/
+void ringNotify(struct ringSignal *signal){
+
+    /* Either the sleeper sees the new position or this sees the sleeper */
+    atomic_thread_fence(memory_order_seq_cst);
+    if(atomic_load_explicit(&signal->sleepers, memory_order_relaxed) != 0){
+        pthread_mutex_lock(&signal->lock);
+        pthread_cond_broadcast(&signal->wake);
+        pthread_mutex_unlock(&signal->lock);
+    }
+}
+
+/**********************************************************************/
+/* Name:        ringWait                                              */
+/*                                                                    */
+/* Description: This function will wait for the other side of the     */
+/*              ring to move a position, spinning for a while, then   */
+/*              yielding, since the two threads may share a           */
+/*              processor, and then sleeping until it is signalled,   */
+/*              so an idle trace costs no processor time              */
+/*                                                                    */
+/* Inputs:      The signal; the position; the value it must leave;    */
+/*              the number of polls so far; the wallClock time to     */
+/*              give up at, 0 for none                                */
+/*                                                                    */
+/* Outputs:     0 to poll again, -1 once the time is up               */
+/**********************************************************************/
+int ringWait(struct ringSignal *signal, atomic_size_t *position, size_t value,
+             unsigned int *polls, double deadline){
+
+    int status = 0;
+
+    if(++*polls < RINGSPINS){
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+        __builtin_ia32_pause();
+#endif
+        return 0;
+    }
+    if(deadline > 0.0 && wallClock() >= deadline)
+        return -1;
+    if(*polls < RINGSPINS + RINGYIELDS){
+        sched_yield();
+        return 0;
+    }
+
+    pthread_mutex_lock(&signal->lock);
+    atomic_fetch_add_explicit(&signal->sleepers, 1, memory_order_seq_cst);
+    if(atomic_load_explicit(position, memory_order_seq_cst) == value){
+        if(deadline > 0.0){
+            struct timespec until;
+            until.tv_sec = (time_t)deadline;
+            until.tv_nsec = (long)((deadline - (double)until.tv_sec) * 1e9);
+            if(pthread_cond_timedwait(&signal->wake, &signal->lock, &until) != 0)
+                status = -1;
+        }
+        else
+            pthread_cond_wait(&signal->wake, &signal->lock);
+    }
+    atomic_fetch_sub_explicit(&signal->sleepers, 1, memory_order_relaxed);
+    pthread_mutex_unlock(&signal->lock);
+    return status;
+}
+
+/**********************************************************************/
+/* Name:        ringProducer                                          */
+/*                                                                    */
+/* Description: This function will parse the trace into the free      */
+/*              blocks of the ring until it ends, with the empty last */
+/*              block marking the end                                 */
+/*                                                                    */
+/* Inputs:      The ring                                              */
+/*                                                                    */
+/* Outputs:     NULL                                                  */
+/**********************************************************************/
+void *ringProducer(void *argument){
+
+    struct traceRing *ring = argument;
+    size_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    struct ringBlock *block;
+
+    do{
+        unsigned int polls = 0;
+        while(head - atomic_load_explicit(&ring->tail, memory_order_acquire) == RINGBLOCKS)
+            ringWait(&ring->signal, &ring->tail, head - RINGBLOCKS, &polls, 0.0);
+        block = &ring->blocks[head & (RINGBLOCKS - 1)];
+        traceMarkPosition(ring->trace, &block->mark);
+        block->count = traceReadAccesses(ring->trace, block->addresses, block->types,
+                                         block->sizes, RINGBLOCK);
+        atomic_store_explicit(&ring->head, ++head, memory_order_release);
+        ringNotify(&ring->signal);
+    } while(block->count > 0);
+    return NULL;
+}
+
+/**********************************************************************/
+/* Name:        ringOpen                                              */
+/*                                                                    */
+/* Description: This function will start parsing a trace on a thread   */
+/*              of its own. The trace belongs to that thread until    */
+/*              ringClose                                             */
+/*                                                                    */
+/* Inputs:      The ring; the open trace, at its first access to      */
+/*              simulate                                              */
+/*                                                                    */
+/* Outputs:     0 on success, -1 if there is no memory or no thread   */
+/**********************************************************************/
+int ringOpen(struct traceRing *ring, struct trace *trace){
+
+    memset(ring, 0, sizeof(*ring));
+    ring->trace = trace;
+    ring->blocks = malloc(RINGBLOCKS * sizeof(struct ringBlock));
+    if(ring->blocks == NULL)
+        return -1;
+    atomic_init(&ring->head, 0);
+    atomic_init(&ring->tail, 0);
+    if(ringSignalInit(&ring->signal) != 0){
+        free(ring->blocks);
+        ring->blocks = NULL;
+        return -1;
+    }
+    if(pthread_create(&ring->thread, NULL, ringProducer, ring) != 0){
+        ringSignalFree(&ring->signal);
+        free(ring->blocks);
+        ring->blocks = NULL;
+        return -1;
+    }
+    return 0;
+}
+
+/**********************************************************************/
+/* Name:        ringNext                                              */
+/*                                                                    */
+/* Description: This function will wait for the next block of the     */
+/*              trace, or until a time                                */
+/*                                                                    */
+/* Inputs:      The ring; the wallClock time to give up at, 0 for     */
+/*              none                                                  */
+/*                                                                    */
+/* Outputs:     The block, with no accesses at the end of the trace;  */
+/*              it stays valid until ringRelease. NULL once the time  */
+/*              is up                                                 */
+/**********************************************************************/
+const struct ringBlock *ringNext(struct traceRing *ring, double deadline){
+
+    size_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    unsigned int polls = 0;
+
+    while(atomic_load_explicit(&ring->head, memory_order_acquire) == tail)
+        if(ringWait(&ring->signal, &ring->head, tail, &polls, deadline) != 0)
+            return NULL;
+    return &ring->blocks[tail & (RINGBLOCKS - 1)];
+}
+
+/**********************************************************************/
+/* Name:        ringRelease                                           */
+/*                                                                    */
+/* Description: This function will give the block of ringNext back to */
+/*              the producer                                          */
+/*                                                                    */
+/* Inputs:      The ring                                              */
+/*                                                                    */
+/* Outputs:     NONE                                                  */
+/**********************************************************************/
+void ringRelease(struct traceRing *ring){
+    size_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    atomic_store_explicit(&ring->tail, tail + 1, memory_order_release);
+    ringNotify(&ring->signal);
+}
+
+/**********************************************************************/
+/* Name:        ringClose                                             */
+/*                                                                    */
+/* Description: This function will wait for the producer, once the     */
+/*              last block has been read, and release the ring        */
+/*                                                                    */
+/* Inputs:      The ring                                              */
+/*                                                                    */
+/* Outputs:     NONE                                                  */
+/**********************************************************************/
+void ringClose(struct traceRing *ring){
+    pthread_join(ring->thread, NULL);
+    ringSignalFree(&ring->signal);
+    free(ring->blocks);
+    memset(ring, 0, sizeof(*ring));
+}
+
+#endif